@@ -0,0 +1,224 @@
+// end to end SsdDetector::Detect latency without the camera: frames come
+// from any FrameSource but the sensor (image directory, video file or
+// synthetic pattern) and are fed round robin, the
+// per stage latency (see DetectTiming) is reported as percentiles and
+// written as JSON so runs can be compared across commits.
+// with -a the face and palm detectors join one ArenaGroup and run
+// alternately, as pipeline stages sharing it would: the timing of the
+// benchmarked one then includes re-acquiring its arena, and the arena
+// memory of the group is printed
+//
+// usage: detector_bench.elf [-d face|palm] [-m model.tflite] [-n iterations]
+//                           [-w warmup] [-o result.json] [-t tag] [-a]
+//                           <image_dir|video|synthetic[:WxH]>
+#include <getopt.h>
+
+#include "../detector.h"
+#include "../frame_source.h"
+#include "../json.h"
+#include "../trace.h"
+
+// frames are read up front, so decoding stays out of the timing
+const int kMaxFrames = 300;
+
+struct Percentiles {
+    double p50, p90, p99, max, mean;
+};
+
+static Percentiles ComputePercentiles(std::vector<double> samples) {
+    std::sort(samples.begin(), samples.end());
+    auto at = [&samples](double p) -> double {
+        size_t index = (size_t)(p * (samples.size() - 1) + 0.5);
+        return samples[index];
+    };
+    double sum = 0;
+    for (double sample : samples) {
+        sum += sample;
+    }
+    return Percentiles{at(0.5), at(0.9), at(0.99), samples.back(),
+                       sum / samples.size()};
+}
+
+static std::vector<cv::Mat> LoadFrames(const std::string &source) {
+    std::vector<cv::Mat> frames;
+    // unthrottled, the pacing of the source doesn't matter here
+    std::unique_ptr<FrameSource> capture = OpenFrameSource(source, 0);
+    if (!capture) {
+        return frames;
+    }
+    while ((int)frames.size() < kMaxFrames) {
+        cv::Mat img = capture->ReadBGRImage();
+        if (img.empty()) {
+            break;
+        }
+        frames.push_back(img.clone());
+    }
+    return frames;
+}
+
+static void Usage(const char *name) {
+    std::cout << "usage: " << name
+              << " [-d face|palm] [-m model.tflite] [-n iterations] "
+                 "[-w warmup] [-o result.json] [-t tag] [-a] "
+                 "<image_dir|video|synthetic[:WxH]>"
+              << std::endl;
+}
+
+// other, if not null, runs on every frame after detector (-a)
+template <typename Detector, typename Other>
+static std::vector<DetectTiming> Run(Detector &detector, Other *other,
+                                     const std::vector<cv::Mat> &frames,
+                                     int iterations, int warmup) {
+    std::vector<DetectTiming> timings;
+    timings.reserve(iterations);
+    for (int i = 0; i < warmup + iterations; i++) {
+        TRACE_FRAME(i);
+        const cv::Mat &frame = frames[i % frames.size()];
+        detector.Detect(frame, kPixelBGR);
+        if (other) {
+            other->Detect(frame, kPixelBGR);
+        }
+        if (i >= warmup) {
+            timings.push_back(detector.LastTiming());
+        }
+    }
+    return timings;
+}
+
+int main(int argc, char *argv[]) {
+    std::string detector_name = "face";
+    std::string model_file;
+    std::string json_file;
+    std::string tag;
+    int iterations = 1000;
+    int warmup = 50;
+    bool arena_group = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "d:m:n:w:o:t:a")) != -1) {
+        switch (opt) {
+            case 'd':
+                detector_name = optarg;
+                break;
+            case 'm':
+                model_file = optarg;
+                break;
+            case 'n':
+                iterations = atoi(optarg);
+                break;
+            case 'w':
+                warmup = atoi(optarg);
+                break;
+            case 'o':
+                json_file = optarg;
+                break;
+            case 't':
+                tag = optarg;
+                break;
+            case 'a':
+                arena_group = true;
+                break;
+            default:
+                Usage(argv[0]);
+                return -1;
+        }
+    }
+    if (optind >= argc || iterations <= 0 ||
+        (detector_name != "face" && detector_name != "palm")) {
+        Usage(argv[0]);
+        return -1;
+    }
+    if (model_file.empty()) {
+        model_file = detector_name == "face" ? kFaceDetectionModel
+                                             : kPalmDetectionModel;
+    }
+    std::string source = argv[optind];
+    std::vector<cv::Mat> frames = LoadFrames(source);
+    if (frames.empty()) {
+        std::cout << "no frames in " << source << std::endl;
+        return -1;
+    }
+
+    std::vector<DetectTiming> timings;
+    ArenaGroup group;
+    ArenaGroup *group_ptr = arena_group ? &group : nullptr;
+    if (detector_name == "face") {
+        FaceDetector detector(model_file, 0, kNMSHard, group_ptr);
+        std::unique_ptr<PalmDetector> other;
+        if (arena_group) {
+            other.reset(new PalmDetector(kPalmDetectionModel, 0, kNMSHard,
+                                         group_ptr));
+        }
+        timings = Run(detector, other.get(), frames, iterations, warmup);
+        if (arena_group) {
+            group.Report();
+        }
+    } else {
+        PalmDetector detector(model_file, 0, kNMSHard, group_ptr);
+        std::unique_ptr<FaceDetector> other;
+        if (arena_group) {
+            other.reset(new FaceDetector(kFaceDetectionModel, 0, kNMSHard,
+                                         group_ptr));
+        }
+        timings = Run(detector, other.get(), frames, iterations, warmup);
+        if (arena_group) {
+            group.Report();
+        }
+    }
+
+    const char *stage_names[] = {"preprocess", "invoke", "decode", "nms",
+                                 "total"};
+    const int kNumStages = sizeof(stage_names) / sizeof(stage_names[0]);
+    std::vector<double> samples[kNumStages];
+    for (const DetectTiming &timing : timings) {
+        samples[0].push_back(timing.preprocess_us);
+        samples[1].push_back(timing.invoke_us);
+        samples[2].push_back(timing.decode_us);
+        samples[3].push_back(timing.nms_us);
+        samples[4].push_back(timing.preprocess_us + timing.invoke_us +
+                             timing.decode_us + timing.nms_us);
+    }
+    Percentiles stats[kNumStages];
+    for (int i = 0; i < kNumStages; i++) {
+        stats[i] = ComputePercentiles(samples[i]);
+    }
+
+    printf("%s: %zu frames from %s, %d iterations, %d warmup\n",
+           model_file.c_str(), frames.size(), source.c_str(), iterations,
+           warmup);
+    printf("%-12s %10s %10s %10s %10s %10s\n", "stage(us)", "p50", "p90",
+           "p99", "max", "mean");
+    for (int i = 0; i < kNumStages; i++) {
+        printf("%-12s %10.1f %10.1f %10.1f %10.1f %10.1f\n", stage_names[i],
+               stats[i].p50, stats[i].p90, stats[i].p99, stats[i].max,
+               stats[i].mean);
+    }
+
+    if (json_file.empty()) {
+        return 0;
+    }
+    FILE *fp = fopen(json_file.c_str(), "w");
+    if (!fp) {
+        std::cout << "can't write " << json_file << std::endl;
+        return -1;
+    }
+    fprintf(fp,
+            "{\n  \"tag\": %s,\n  \"detector\": %s,\n"
+            "  \"model\": %s,\n  \"source\": %s,\n"
+            "  \"frames\": %zu,\n  \"iterations\": %d,\n  \"warmup\": %d,\n"
+            "  \"arena_group\": %s,\n"
+            "  \"unit\": \"us\",\n  \"stages\": {\n",
+            JsonString(tag).c_str(), JsonString(detector_name).c_str(),
+            JsonString(model_file).c_str(), JsonString(source).c_str(),
+            frames.size(), iterations, warmup,
+            arena_group ? "true" : "false");
+    for (int i = 0; i < kNumStages; i++) {
+        fprintf(fp,
+                "    \"%s\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, "
+                "\"max\": %.1f, \"mean\": %.1f}%s\n",
+                stage_names[i], stats[i].p50, stats[i].p90, stats[i].p99,
+                stats[i].max, stats[i].mean, i + 1 < kNumStages ? "," : "");
+    }
+    fprintf(fp, "  }\n}\n");
+    fclose(fp);
+    return 0;
+}
@@ -0,0 +1,32 @@
+// time to first inference: model load + interpreter build + first Invoke,
+// the startup cost the op resolver choice affects
+//
+// usage: first_inference_bench.elf model.tflite...
+#include "../common.h"
+#include "../tflite/nn_tflite.h"
+
+static double ElapsedMs(steady_clock::time_point start) {
+    return duration_cast<microseconds>(steady_clock::now() - start).count() /
+           1000.0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cout << "usage: " << argv[0] << " model.tflite..." << std::endl;
+        return -1;
+    }
+    for (int i = 1; i < argc; i++) {
+        steady_clock::time_point start = steady_clock::now();
+        NNTFLite nn(argv[i]);
+        double load_ms = ElapsedMs(start);
+        nn.Invoke();
+        double first_ms = ElapsedMs(start);
+        steady_clock::time_point second = steady_clock::now();
+        nn.Invoke();
+        double steady_ms = ElapsedMs(second);
+        printf("%-40s load %8.2f ms  first inference %8.2f ms  "
+               "next invoke %8.2f ms\n",
+               argv[i], load_ms, first_ms, steady_ms);
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+// fused Preprocessor vs. the OpenCV chain Detector::Detect used to run:
+// cvtColor -> ResizeAndKeepAspectRatio -> convertTo -> memcpy, and
+// ConvertToBGR vs. the cvtColor -> flip VideoCapture::ReadBGRImage used
+// to run
+//
+// usage: preprocess_bench.elf [width height iterations]
+#include "../preprocess.h"
+#include "../ssd_spec.h"
+#include "../util.h"
+
+struct Format {
+    const char *name;
+    PixelFormat format;
+    int type;
+    int to_rgb;  // -1: already RGB, no cvtColor
+};
+
+static double ElapsedUs(steady_clock::time_point start) {
+    return duration_cast<nanoseconds>(steady_clock::now() - start).count() /
+           1000.0;
+}
+
+static void OpenCVChain(const cv::Mat &frame, const Format &format,
+                        int roi_width, int roi_height, float *output) {
+    cv::Mat img = frame;
+    if (format.to_rgb >= 0) {
+        cv::cvtColor(frame, img, format.to_rgb);
+    }
+    ResizedImage resized_image =
+        ResizeAndKeepAspectRatio(img, roi_width, roi_height);
+    img = resized_image.img;
+    img.convertTo(img, CV_32F, 1.0 / 127.5, -1);
+    memcpy(output, img.data, img.total() * img.elemSize());
+}
+
+int main(int argc, char *argv[]) {
+    int width = 1280;
+    int height = 720;
+    int iterations = 1000;
+    if (argc == 4) {
+        width = atoi(argv[1]);
+        height = atoi(argv[2]);
+        iterations = atoi(argv[3]);
+    }
+    const Format formats[] = {
+        {"RGB", kPixelRGB, CV_8UC3, -1},
+        {"BGR", kPixelBGR, CV_8UC3, cv::COLOR_BGR2RGB},
+        {"RGBA", kPixelRGBA, CV_8UC4, cv::COLOR_RGBA2RGB},
+        {"BGRA", kPixelBGRA, CV_8UC4, cv::COLOR_BGRA2RGB},
+    };
+    const int roi_width = FaceDetectionSpec::kInputWidth;
+    const int roi_height = FaceDetectionSpec::kInputHeight;
+    std::vector<float> expected(roi_width * roi_height * 3);
+    std::vector<float> actual(roi_width * roi_height * 3);
+    Preprocessor preprocessor(roi_width, roi_height);
+
+    printf("%dx%d -> %dx%d, %d iterations\n", width, height, roi_width,
+           roi_height, iterations);
+    printf("%-6s %12s %12s %8s %10s\n", "format", "opencv(us)", "fused(us)",
+           "speedup", "max_diff");
+    for (const Format &format : formats) {
+        cv::Mat frame(height, width, format.type);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+
+        steady_clock::time_point start = steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            OpenCVChain(frame, format, roi_width, roi_height,
+                        expected.data());
+        }
+        double opencv_us = ElapsedUs(start) / iterations;
+
+        start = steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            preprocessor.Run(frame, format.format, actual.data());
+        }
+        double fused_us = ElapsedUs(start) / iterations;
+
+        float max_diff = 0;
+        for (size_t i = 0; i < actual.size(); i++) {
+            max_diff = std::max(max_diff, std::abs(actual[i] - expected[i]));
+        }
+        printf("%-6s %12.1f %12.1f %7.2fx %10.4f\n", format.name, opencv_us,
+               fused_us, opencv_us / fused_us, max_diff);
+    }
+
+    printf("\n%-6s %12s %12s %8s %10s\n", "to BGR", "opencv(us)",
+           "fused(us)", "speedup", "max_diff");
+    cv::Mat converted;
+    for (const Format &format : formats) {
+        cv::Mat frame(height, width, format.type);
+        cv::randu(frame, cv::Scalar::all(0), cv::Scalar::all(255));
+        // the OpenCV equivalent of every format's ConvertToBGR
+        int to_bgr = format.format == kPixelRGB    ? cv::COLOR_RGB2BGR
+                     : format.format == kPixelRGBA ? cv::COLOR_RGBA2BGR
+                     : format.format == kPixelBGRA ? cv::COLOR_BGRA2BGR
+                                                   : -1;
+        cv::Mat expected;
+        steady_clock::time_point start = steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            cv::Mat img = frame;
+            if (to_bgr >= 0) {
+                cv::cvtColor(frame, img, to_bgr);
+            }
+            cv::flip(img, expected, 1);
+        }
+        double opencv_us = ElapsedUs(start) / iterations;
+
+        start = steady_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            ConvertToBGR(frame, format.format, true, converted);
+        }
+        double fused_us = ElapsedUs(start) / iterations;
+
+        int max_diff = 0;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width * 3; x++) {
+                max_diff = std::max(max_diff, std::abs(converted.ptr(y)[x] -
+                                                       expected.ptr(y)[x]));
+            }
+        }
+        printf("%-6s %12.1f %12.1f %7.2fx %10d\n", format.name, opencv_us,
+               fused_us, opencv_us / fused_us, max_diff);
+    }
+    return 0;
+}
@@ -0,0 +1,521 @@
+#include "broker.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+#include "../json.h"
+
+using namespace std::chrono;
+
+// how often the rates are measured and the limits sent
+const int64_t kWindowNs = 1000000000;
+// a subscriber gets up to that much more than it was measured to consume,
+// so the rate can grow back
+const double kHeadroom = 1.25;
+// the lowest limit sent to the publishers
+const double kMinRate = 0.5;
+// unreported messages are given up on after that
+const int64_t kStaleNs = 2000000000;
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static int64_t NowNs() {
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())
+        .count();
+}
+
+Broker::Broker(const BrokerConfig &config)
+    : config(config),
+      ctx(zmq_ctx_new()),
+      frontend(nullptr),
+      backend(nullptr),
+      stats_socket(nullptr),
+      feedback_socket(nullptr),
+      start_time(NowNs()),
+      window_start(start_time) {}
+
+Broker::~Broker() {
+    for (void *socket : {this->frontend, this->backend, this->stats_socket,
+                         this->feedback_socket}) {
+        if (socket) {
+            zmq_close(socket);
+        }
+    }
+    zmq_ctx_term(this->ctx);
+}
+
+bool Broker::Open() {
+    int linger = 0;
+    // a full subscriber queue makes the send fail instead of silently
+    // dropping, Forward() counts it
+    int nodrop = 1;
+    // the subscriptions are set per subscriber by HandleSubscription()
+    int manual = 1;
+    this->frontend = zmq_socket(this->ctx, ZMQ_XSUB);
+    this->backend = zmq_socket(this->ctx, ZMQ_XPUB);
+    this->stats_socket = zmq_socket(this->ctx, ZMQ_REP);
+    this->feedback_socket = zmq_socket(this->ctx, ZMQ_PULL);
+    for (void *socket : {this->frontend, this->backend, this->stats_socket,
+                         this->feedback_socket}) {
+        zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger));
+    }
+    zmq_setsockopt(this->backend, ZMQ_SNDHWM, &this->config.hwm,
+                   sizeof(this->config.hwm));
+    zmq_setsockopt(this->backend, ZMQ_XPUB_NODROP, &nodrop, sizeof(nodrop));
+    zmq_setsockopt(this->backend, ZMQ_XPUB_MANUAL, &manual, sizeof(manual));
+    const std::pair<void *, const std::string *> binds[] = {
+        {this->frontend, &this->config.inbound},
+        {this->backend, &this->config.outbound},
+        {this->stats_socket, &this->config.stats},
+        {this->feedback_socket, &this->config.feedback},
+    };
+    for (const auto &bind : binds) {
+        if (zmq_bind(bind.first, bind.second->c_str()) != 0) {
+            std::cout << "Failed to bind " << *bind.second << ": "
+                      << zmq_strerror(zmq_errno()) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// the token bucket of a subscriber, true if it gets a message now
+static bool Admit(SubscriberState *subscriber, int64_t now, int hwm) {
+    if (subscriber->in_flight > 0 &&
+        now - subscriber->last_report > kStaleNs) {
+        // its reports got lost, or it hangs: as if it were idle
+        subscriber->in_flight = 0;
+    }
+    double refill = subscriber->rate < 0
+                        ? hwm
+                        : (now - subscriber->last_refill) / 1e9 *
+                              subscriber->rate * kHeadroom;
+    subscriber->tokens = std::min<double>(hwm, subscriber->tokens + refill);
+    subscriber->last_refill = now;
+    if (subscriber->in_flight == 0) {
+        // idle, the stale timeout starts now
+        subscriber->last_report = now;
+    } else if (subscriber->in_flight >= (uint64_t)hwm ||
+               subscriber->tokens < 1) {
+        return false;
+    }
+    subscriber->tokens = std::max(0.0, subscriber->tokens - 1);
+    return true;
+}
+
+const std::vector<SubscriberState *> &Broker::Route(
+    const std::string &topic) {
+    auto it = this->routes.find(topic);
+    if (it != this->routes.end()) {
+        return it->second;
+    }
+    std::vector<SubscriberState *> &route = this->routes[topic];
+    for (auto &subscriber : this->subscribers) {
+        const std::string &prefix = subscriber.second.prefix;
+        if (topic.compare(0, prefix.size(), prefix) == 0) {
+            route.push_back(&subscriber.second);
+        }
+    }
+    return route;
+}
+
+// the message in parts to one subscriber, under its topic. false if its
+// queue is full (EAGAIN) or on a socket error
+bool Broker::Send(SubscriberState *subscriber) {
+    this->subscriber_topic.assign(subscriber->filter);
+    this->subscriber_topic.append(this->topic, subscriber->prefix.size(),
+                                  std::string::npos);
+    size_t count = this->parts.size();
+    int flags = ZMQ_DONTWAIT | (count > 1 ? ZMQ_SNDMORE : 0);
+    if (zmq_send(this->backend, this->subscriber_topic.data(),
+                 this->subscriber_topic.size(), flags) < 0) {
+        return false;
+    }
+    // the rest follows the first part, the payloads are shared
+    for (size_t i = 1; i < count; i++) {
+        zmq_msg_t part;
+        zmq_msg_init(&part);
+        zmq_msg_copy(&part, &this->parts[i]);
+        if (zmq_msg_send(&part, this->backend,
+                         i + 1 < count ? ZMQ_SNDMORE : 0) < 0) {
+            zmq_msg_close(&part);
+            return false;
+        }
+    }
+    return true;
+}
+
+// one message from a publisher to the subscribers: 1 if one was
+// forwarded, 0 if none was waiting, -1 on a socket error
+int Broker::Forward() {
+    bool more = true;
+    while (more) {
+        this->parts.emplace_back();
+        zmq_msg_t *part = &this->parts.back();
+        zmq_msg_init(part);
+        int flags = this->parts.size() == 1 ? ZMQ_DONTWAIT : 0;
+        if (zmq_msg_recv(part, this->frontend, flags) < 0) {
+            int error = zmq_errno();
+            bool none = this->parts.size() == 1 && error == EAGAIN;
+            for (zmq_msg_t &received : this->parts) {
+                zmq_msg_close(&received);
+            }
+            this->parts.clear();
+            return none ? 0 : -1;
+        }
+        more = zmq_msg_more(part);
+    }
+    this->topic.assign((const char *)zmq_msg_data(&this->parts[0]),
+                       zmq_msg_size(&this->parts[0]));
+    auto it = this->topics.find(this->topic);
+    if (it == this->topics.end()) {
+        it = this->topics.emplace(this->topic, TopicStats()).first;
+        it->second.rate = it->second.limit = -1;
+    }
+    TopicStats &stats = it->second;
+    stats.messages++;
+    stats.window_messages++;
+    for (zmq_msg_t &part : this->parts) {
+        stats.bytes += zmq_msg_size(&part);
+    }
+
+    int64_t now = NowNs();
+    bool missed = false;
+    int result = 1;
+    for (SubscriberState *subscriber : Route(this->topic)) {
+        if (subscriber->in_flight > 0) {
+            subscriber->window_busy++;
+        }
+        if (!subscriber->monitor &&
+            !Admit(subscriber, now, this->config.hwm)) {
+            subscriber->throttled++;
+        } else if (Send(subscriber)) {
+            subscriber->sent++;
+            if (!subscriber->monitor) {
+                // monitors don't report
+                subscriber->in_flight++;
+            }
+            continue;
+        } else if (zmq_errno() == EAGAIN) {
+            subscriber->dropped++;
+        } else {
+            result = -1;
+            break;
+        }
+        subscriber->window_busy++;
+        missed = true;
+    }
+    if (missed) {
+        stats.dropped++;
+    }
+    for (zmq_msg_t &part : this->parts) {
+        zmq_msg_close(&part);
+    }
+    this->parts.clear();
+    return result;
+}
+
+void Broker::Subscribe(const std::string &id, const std::string &prefix) {
+    bool first = true;
+    for (const auto &subscriber : this->subscribers) {
+        first = first && subscriber.second.prefix != prefix;
+    }
+    int64_t now = NowNs();
+    SubscriberState &subscriber = this->subscribers[id];
+    subscriber = SubscriberState();
+    subscriber.prefix = prefix;
+    subscriber.filter = prefix + '\0' + id + '\0';
+    subscriber.monitor = !id.empty() && id[0] == '*';
+    subscriber.rate = -1;
+    subscriber.tokens = this->config.hwm;
+    subscriber.last_refill = subscriber.last_report = now;
+    // to the pipe of the last subscription, the subscriber's
+    zmq_setsockopt(this->backend, ZMQ_SUBSCRIBE, subscriber.filter.data(),
+                   subscriber.filter.size());
+    this->routes.clear();
+    if (first) {
+        std::string subscription = '\1' + prefix;
+        zmq_send(this->frontend, subscription.data(), subscription.size(), 0);
+    }
+}
+
+void Broker::Unsubscribe(const std::string &id, const std::string &prefix) {
+    auto it = this->subscribers.find(id);
+    if (it == this->subscribers.end()) {
+        return;
+    }
+    // a no-op if the subscriber is gone, its pipe took its filter along
+    zmq_setsockopt(this->backend, ZMQ_UNSUBSCRIBE, it->second.filter.data(),
+                   it->second.filter.size());
+    this->subscribers.erase(it);
+    this->routes.clear();
+    for (const auto &subscriber : this->subscribers) {
+        if (subscriber.second.prefix == prefix) {
+            return;
+        }
+    }
+    std::string unsubscription = '\0' + prefix;
+    zmq_send(this->frontend, unsubscription.data(), unsubscription.size(), 0);
+}
+
+// a (un)subscription of a subscriber, on terminated connections too
+bool Broker::HandleSubscription() {
+    zmq_msg_t msg;
+    zmq_msg_init(&msg);
+    if (zmq_msg_recv(&msg, this->backend, ZMQ_DONTWAIT) < 0) {
+        zmq_msg_close(&msg);
+        return zmq_errno() == EAGAIN;
+    }
+    const char *data = (const char *)zmq_msg_data(&msg);
+    size_t size = zmq_msg_size(&msg);
+    bool subscribe = size > 0 && data[0] == 1;
+    std::string filter(size > 0 ? data + 1 : data, size > 0 ? size - 1 : 0);
+    zmq_msg_close(&msg);
+
+    size_t end = filter.size() > 1 && filter[0] == '\0'
+                     ? filter.find('\0', 1)
+                     : std::string::npos;
+    if (filter == kRatesTopic) {
+        if (subscribe) {
+            zmq_setsockopt(this->backend, ZMQ_SUBSCRIBE, filter.data(),
+                           filter.size());
+        }
+    } else if (end != std::string::npos) {
+        // \0 id \0 prefix
+        std::string id = filter.substr(1, end - 1);
+        std::string prefix = filter.substr(end + 1);
+        if (subscribe) {
+            Subscribe(id, prefix);
+        } else {
+            Unsubscribe(id, prefix);
+        }
+    } else if (!subscribe && filter.size() > 2 && filter.back() == '\0') {
+        // prefix \0 id \0, the filter Subscribe() set: zmq drops it when the
+        // subscriber's connection terminates
+        size_t id_start = filter.find('\0') + 1;
+        if (id_start < filter.size() - 1) {
+            Unsubscribe(
+                filter.substr(id_start, filter.size() - 1 - id_start),
+                filter.substr(0, id_start - 1));
+        }
+    }
+    // the plain prefix of a subscriber comes with its id, the ones above
+    return true;
+}
+
+// [id, count]: count messages came off the subscriber's queue, one of
+// them was consumed
+bool Broker::ReadFeedback() {
+    int64_t now = NowNs();
+    for (int i = 0; i < 256; i++) {
+        char id[256];
+        char count[32];
+        int id_size = zmq_recv(this->feedback_socket, id, sizeof(id),
+                               ZMQ_DONTWAIT);
+        if (id_size < 0) {
+            return zmq_errno() == EAGAIN;
+        }
+        int more;
+        size_t more_size = sizeof(more);
+        zmq_getsockopt(this->feedback_socket, ZMQ_RCVMORE, &more, &more_size);
+        if (!more) {
+            continue;
+        }
+        int count_size =
+            zmq_recv(this->feedback_socket, count, sizeof(count) - 1, 0);
+        if (count_size < 0) {
+            return false;
+        }
+        count[std::min<int>(count_size, sizeof(count) - 1)] = 0;
+        auto it = this->subscribers.find(
+            std::string(id, std::min<int>(id_size, sizeof(id))));
+        if (it == this->subscribers.end()) {
+            continue;
+        }
+        SubscriberState &subscriber = it->second;
+        uint64_t taken = strtoull(count, nullptr, 10);
+        subscriber.in_flight -= std::min(taken, subscriber.in_flight);
+        subscriber.window_consumed++;
+        subscriber.last_report = now;
+    }
+    return true;
+}
+
+bool Broker::ServeStats() {
+    zmq_msg_t request;
+    zmq_msg_init(&request);
+    int rc = zmq_msg_recv(&request, this->stats_socket, ZMQ_DONTWAIT);
+    bool more = rc >= 0 && zmq_msg_more(&request);
+    zmq_msg_close(&request);
+    if (rc < 0) {
+        return zmq_errno() == EAGAIN;
+    }
+    while (more) {
+        zmq_msg_init(&request);
+        zmq_msg_recv(&request, this->stats_socket, 0);
+        more = zmq_msg_more(&request);
+        zmq_msg_close(&request);
+    }
+    std::string json = StatsJson();
+    return zmq_send(this->stats_socket, json.data(), json.size(), 0) >= 0;
+}
+
+// rates below 0 are unknown or unlimited
+static void JsonRate(std::ostream &out, double rate) {
+    if (rate < 0) {
+        out << "null";
+    } else {
+        out << rate;
+    }
+}
+
+void Broker::UpdateRates(int64_t now) {
+    if (now - this->window_start < kWindowNs) {
+        return;
+    }
+    double seconds = (now - this->window_start) / 1e9;
+    this->window_start = now;
+    for (auto &it : this->subscribers) {
+        SubscriberState &subscriber = it.second;
+        if (subscriber.window_busy > 0 && !subscriber.monitor) {
+            // it was the bottleneck, what it consumed is what it can take
+            double rate = subscriber.window_consumed / seconds;
+            subscriber.rate = subscriber.rate < 0
+                                  ? rate
+                                  : (subscriber.rate + rate) / 2;
+        } else {
+            subscriber.rate = -1;
+        }
+        subscriber.window_consumed = subscriber.window_busy = 0;
+    }
+
+    std::ostringstream limits;
+    limits << "{";
+    bool first = true;
+    for (auto &it : this->topics) {
+        TopicStats &stats = it.second;
+        stats.rate = stats.window_messages / seconds;
+        stats.window_messages = 0;
+        // the fastest subscriber's rate, none if one keeps up
+        stats.limit = -1;
+        for (const SubscriberState *subscriber : Route(it.first)) {
+            if (subscriber->monitor) {
+                continue;
+            }
+            if (subscriber->rate < 0) {
+                stats.limit = -1;
+                break;
+            }
+            stats.limit = std::max(
+                {stats.limit, subscriber->rate * kHeadroom, kMinRate});
+        }
+        if (stats.limit >= 0) {
+            limits << (first ? "" : ", ");
+            first = false;
+            JsonBytes(limits, it.first);
+            limits << ": " << stats.limit;
+        }
+    }
+    limits << "}";
+    // publishers whose queue is full get the next one
+    std::string json = limits.str();
+    if (zmq_send(this->backend, kRatesTopic.data(), kRatesTopic.size(),
+                 ZMQ_SNDMORE | ZMQ_DONTWAIT) >= 0) {
+        zmq_send(this->backend, json.data(), json.size(), 0);
+    }
+}
+
+void Broker::Run() {
+    zmq_pollitem_t items[] = {
+        {this->frontend, 0, ZMQ_POLLIN, 0},
+        {this->backend, 0, ZMQ_POLLIN, 0},
+        {this->stats_socket, 0, ZMQ_POLLIN, 0},
+        {this->feedback_socket, 0, ZMQ_POLLIN, 0},
+    };
+    while (!stop_requested) {
+        int64_t now = NowNs();
+        long timeout =
+            std::max<int64_t>(0, this->window_start + kWindowNs - now) /
+                1000000 +
+            1;
+        if (zmq_poll(items, 4, timeout) < 0) {
+            if (zmq_errno() == EINTR) {
+                continue;
+            }
+            std::cout << "zmq_poll: " << zmq_strerror(zmq_errno())
+                      << std::endl;
+            return;
+        }
+        bool ok = true;
+        // the reports first, they free the subscribers for the messages
+        if (items[3].revents & ZMQ_POLLIN) {
+            ok = ReadFeedback();
+        }
+        if (ok && (items[0].revents & ZMQ_POLLIN)) {
+            // drain a burst before polling again, up to a bound so the
+            // subscriptions and stats aren't starved
+            int forwarded = 1;
+            for (int i = 0; forwarded > 0 && i < 256; i++) {
+                forwarded = Forward();
+            }
+            ok = forwarded >= 0;
+        }
+        if (ok && (items[1].revents & ZMQ_POLLIN)) {
+            ok = HandleSubscription();
+        }
+        if (ok && (items[2].revents & ZMQ_POLLIN)) {
+            ok = ServeStats();
+        }
+        if (!ok) {
+            std::cout << "broker: " << zmq_strerror(zmq_errno())
+                      << std::endl;
+            return;
+        }
+        UpdateRates(NowNs());
+    }
+}
+
+void Broker::Stop() { stop_requested = 1; }
+
+std::string Broker::StatsJson() const {
+    // sorted, the output is read by people too
+    std::map<std::string, TopicStats> topics(this->topics.begin(),
+                                             this->topics.end());
+    std::ostringstream out;
+    out << "{\"uptime_s\": " << (NowNs() - this->start_time) / 1e9
+        << ", \"topics\": {";
+    bool first = true;
+    for (const auto &topic : topics) {
+        out << (first ? "" : ", ");
+        first = false;
+        JsonBytes(out, topic.first);
+        out << ": {\"messages\": " << topic.second.messages
+            << ", \"bytes\": " << topic.second.bytes
+            << ", \"dropped\": " << topic.second.dropped << ", \"rate\": ";
+        JsonRate(out, topic.second.rate);
+        out << ", \"limit\": ";
+        JsonRate(out, topic.second.limit);
+        out << "}";
+    }
+    out << "}, \"subscribers\": {";
+    first = true;
+    for (const auto &subscriber : this->subscribers) {
+        out << (first ? "" : ", ");
+        first = false;
+        JsonBytes(out, subscriber.first);
+        out << ": {\"topic\": ";
+        JsonBytes(out, subscriber.second.prefix);
+        out << ", \"rate\": ";
+        JsonRate(out, subscriber.second.rate);
+        out << ", \"sent\": " << subscriber.second.sent
+            << ", \"throttled\": " << subscriber.second.throttled
+            << ", \"dropped\": " << subscriber.second.dropped << "}";
+    }
+    out << "}}";
+    return out.str();
+}
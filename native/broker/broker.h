@@ -0,0 +1,134 @@
+// 2026-10-17 23:20
+#ifndef BROKER_BROKER_H
+#define BROKER_BROKER_H
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <zmq.h>
+
+// the message broker of the Python apps (python/message_broker) as a
+// native XSUB / XPUB proxy in its own process: publishers connect to
+// inbound, subscribers to outbound, subscriptions flow back upstream.
+// messages are [topic, payload...] multipart, payloads are never copied.
+//
+// every subscriber socket names itself: next to its topic prefix it
+// subscribes to "\0<id>\0<prefix>", and gets its messages with the topic
+// "<prefix>\0<id>\0<rest of the topic>" (python/message_broker/transport.py
+// takes them apart). so the broker sends each subscriber its own messages,
+// at the rate it consumes them: the subscriber reports [id, count] on the
+// feedback socket for the messages it took off its queue, and a token
+// bucket per subscriber refills at the rate it was measured to consume at.
+// a subscriber that is idle always gets the latest message, one with hwm
+// messages unreported none. a message it doesn't get is counted as
+// throttled, one that doesn't fit into its queue as dropped. subscriptions
+// without an id get nothing, a subscriber that unsubscribes or whose
+// connection closes is forgotten. a subscriber whose id starts with '*' only
+// watches (the latency collector, collector/collector.h): it isn't paced,
+// gets every message that fits into its queue, and limits no publisher.
+//
+// publishers subscribe to kRatesTopic, on which the broker sends the rate
+// per topic its subscribers can take, {"face_roi_small": 1.2, ...}, once a
+// second: their Throttler then skips what would be thrown away. a topic
+// with a subscriber that keeps up with it isn't listed.
+//
+// the counters are served as JSON on the stats socket, a REP socket
+// answering any request:
+//
+//   {"uptime_s": 12.5,
+//    "topics": {"image": {"messages": 375, "bytes": 24000, "dropped": 3,
+//               "rate": 30.0, "limit": null}, ...},
+//    "subscribers": {"4711.0": {"topic": "image", "rate": 12.1,
+//                    "sent": 150, "throttled": 220, "dropped": 0}, ...}}
+
+const std::string kRatesTopic("\0rates", 6);
+
+struct TopicStats {
+    uint64_t messages;
+    uint64_t bytes;
+    // messages at least one subscriber didn't get
+    uint64_t dropped;
+    // published per second, and the limit sent to its publishers (-1: none)
+    double rate;
+    double limit;
+    uint64_t window_messages;
+};
+
+struct SubscriberState {
+    std::string prefix;
+    // prefix \0 id \0, every topic sent to it starts with it
+    std::string filter;
+    // id starts with '*'
+    bool monitor;
+    // consumed per second while it was the bottleneck, -1 while every
+    // message finds it idle
+    double rate;
+    double tokens;
+    int64_t last_refill;
+    int64_t last_report;
+    // sent and not reported yet
+    uint64_t in_flight;
+    uint64_t window_consumed;
+    // messages that found it busy, or that it didn't get
+    uint64_t window_busy;
+    uint64_t sent;
+    uint64_t throttled;
+    uint64_t dropped;
+};
+
+struct BrokerConfig {
+    std::string inbound;
+    std::string outbound;
+    std::string stats;
+    std::string feedback;
+    int hwm;
+};
+
+class Broker {
+   private:
+    BrokerConfig config;
+    void *ctx;
+    void *frontend;
+    void *backend;
+    void *stats_socket;
+    void *feedback_socket;
+    std::unordered_map<std::string, TopicStats> topics;
+    // by id, sorted for the stats
+    std::map<std::string, SubscriberState> subscribers;
+    // the subscribers of a topic, rebuilt when the subscriptions change
+    std::unordered_map<std::string, std::vector<SubscriberState *>> routes;
+    // the last message, reused so the lookups don't allocate
+    std::string topic;
+    // a deque, parts must not move while they are open
+    std::deque<zmq_msg_t> parts;
+    std::string subscriber_topic;
+    int64_t start_time;
+    int64_t window_start;
+    int Forward();
+    bool Send(SubscriberState *subscriber);
+    const std::vector<SubscriberState *> &Route(const std::string &topic);
+    bool HandleSubscription();
+    void Subscribe(const std::string &id, const std::string &prefix);
+    void Unsubscribe(const std::string &id, const std::string &prefix);
+    bool ReadFeedback();
+    bool ServeStats();
+    // once a window: the rates, and the limits sent to the publishers
+    void UpdateRates(int64_t now);
+
+   public:
+    explicit Broker(const BrokerConfig &config);
+    ~Broker();
+    // false (with the reason printed) if a socket couldn't be bound
+    bool Open();
+    // until Stop() or a socket error
+    void Run();
+    // async signal safe
+    static void Stop();
+    std::string StatsJson() const;
+};
+
+#endif  // BROKER_BROKER_H
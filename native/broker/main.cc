@@ -0,0 +1,34 @@
+// the message broker for python/message_broker, see broker.h. started by
+// python/message_broker/main.py when it is built
+//
+// usage: broker.elf [inbound outbound stats feedback [hwm]]
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+
+#include "broker.h"
+
+static void OnSignal(int) { Broker::Stop(); }
+
+int main(int argc, char *argv[]) {
+    if (argc != 1 && argc != 5 && argc != 6) {
+        std::cout << "usage: " << argv[0]
+                  << " [inbound outbound stats feedback [hwm]]" << std::endl;
+        return -1;
+    }
+    BrokerConfig config;
+    config.inbound = argc > 1 ? argv[1] : "tcp://127.0.0.1:5555";
+    config.outbound = argc > 2 ? argv[2] : "tcp://127.0.0.1:5556";
+    config.stats = argc > 3 ? argv[3] : "tcp://127.0.0.1:5557";
+    config.feedback = argc > 4 ? argv[4] : "tcp://127.0.0.1:5558";
+    config.hwm = argc > 5 ? atoi(argv[5]) : 4;
+
+    Broker broker(config);
+    if (!broker.Open()) {
+        return -1;
+    }
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+    broker.Run();
+    return 0;
+}
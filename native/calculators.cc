@@ -0,0 +1,323 @@
+#include "calculators.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "trace.h"
+
+// python's //, rounds towards negative infinity
+static int FloorDiv(int a, int b) {
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
+// the steady_clock ns of a capture at system_ns (system_clock, the sensor's
+// timestamps), so the latencies include the wait until the frame was read.
+// a timestamp ahead of the system clock counts as now
+static int64_t CaptureNs(int64_t system_ns) {
+    int64_t steady_now =
+        duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())
+            .count();
+    int64_t system_now =
+        duration_cast<nanoseconds>(system_clock::now().time_since_epoch())
+            .count();
+    return steady_now - std::max(system_now - system_ns, (int64_t)0);
+}
+
+InuCaptureCalculator::InuCaptureCalculator(bool async, bool flip,
+                                           PixelFormat format)
+    : capture(async, flip, format == kPixelRGB), format(format) {}
+
+void InuCaptureCalculator::GetContract(CalculatorContract *contract) const {
+    contract->Output<ColorImage>();
+    contract->Output<DepthImage>();
+}
+
+bool InuCaptureCalculator::Process(const std::vector<Packet> &,
+                                   std::vector<Packet> &outputs) {
+    shared_ptr<const RGBDFrame> frame = this->capture.ReadRGBDFrame();
+    if (!frame) {
+        return false;
+    }
+    this->timestamp = frame->bgr_timestamp;
+    this->capture_ns = CaptureNs(frame->bgr_timestamp);
+    outputs[0] = Output(ColorImage{frame->bgr, this->format, frame});
+    if (!frame->depth.empty()) {
+        outputs[1] = Output(DepthImage{frame->depth, frame});
+    }
+    return true;
+}
+
+FrameSourceCalculator::FrameSourceCalculator(
+    std::unique_ptr<FrameSource> source, PixelFormat format)
+    : source(std::move(source)), format(format) {}
+
+void FrameSourceCalculator::GetContract(CalculatorContract *contract) const {
+    contract->Output<ColorImage>();
+}
+
+bool FrameSourceCalculator::Process(const std::vector<Packet> &,
+                                    std::vector<Packet> &outputs) {
+    cv::Mat img = this->source->ReadBGRImage();
+    if (img.empty()) {
+        return false;
+    }
+    this->timestamp = this->source->BGRTimestamp();
+    // a recording's timestamps are of when it was recorded, its frames are
+    // captured as they are read
+    bool live = this->timestamp != 0 && this->source->IsLive();
+    if (this->timestamp == 0) {
+        this->timestamp = duration_cast<nanoseconds>(
+                              system_clock::now().time_since_epoch())
+                              .count();
+    }
+    this->capture_ns =
+        live ? CaptureNs(this->timestamp)
+             : duration_cast<nanoseconds>(
+                   steady_clock::now().time_since_epoch())
+                   .count();
+    if (this->format == kPixelRGB) {
+        // a new Mat every frame, consumers may still hold the last one
+        cv::Mat rgb;
+        ConvertToBGR(img, kPixelRGB, false, rgb);
+        img = rgb;
+    }
+    outputs[0] = Output(ColorImage{img, this->format, nullptr});
+    return true;
+}
+
+FaceDetectionCalculator::FaceDetectionCalculator(
+    const std::string &model_file)
+    : detector(model_file) {}
+
+void FaceDetectionCalculator::GetContract(
+    CalculatorContract *contract) const {
+    contract->Input<ColorImage>();
+    contract->Output<FaceDetections>();
+}
+
+bool FaceDetectionCalculator::Process(const std::vector<Packet> &inputs,
+                                      std::vector<Packet> &outputs) {
+    const ColorImage &image = inputs[0].Get<ColorImage>();
+    outputs[0] = Output(this->detector.Detect(image.image, image.format));
+    return true;
+}
+
+PointVelocityFilter::PointVelocityFilter(float cov_process,
+                                         float cov_measure)
+    : state(), cov(), cov_process(cov_process), cov_measure(cov_measure) {}
+
+void PointVelocityFilter::Update(float *x, float *y) {
+    // predict with F = [I I; 0 I]: the position moves by the velocity
+    float *s = this->state;
+    float(*p)[4] = this->cov;
+    s[0] += s[2];
+    s[1] += s[3];
+    // P = F P F' + Q, F P first, then (F P) F'
+    for (int j = 0; j < 4; j++) {
+        p[0][j] += p[2][j];
+        p[1][j] += p[3][j];
+    }
+    for (int i = 0; i < 4; i++) {
+        p[i][0] += p[i][2];
+        p[i][1] += p[i][3];
+        p[i][i] += this->cov_process;
+    }
+
+    // correct, only the position is measured (H = [I 0])
+    float s00 = p[0][0] + this->cov_measure;
+    float s01 = p[0][1];
+    float s10 = p[1][0];
+    float s11 = p[1][1] + this->cov_measure;
+    float det = s00 * s11 - s01 * s10;
+    float inv[2][2] = {{s11 / det, -s01 / det}, {-s10 / det, s00 / det}};
+    float gain[4][2];
+    for (int i = 0; i < 4; i++) {
+        gain[i][0] = p[i][0] * inv[0][0] + p[i][1] * inv[1][0];
+        gain[i][1] = p[i][0] * inv[0][1] + p[i][1] * inv[1][1];
+    }
+    float dx = *x - s[0];
+    float dy = *y - s[1];
+    for (int i = 0; i < 4; i++) {
+        s[i] += gain[i][0] * dx + gain[i][1] * dy;
+    }
+    // P -= K H P, H P is the first two rows of P
+    float hp[2][4];
+    for (int j = 0; j < 4; j++) {
+        hp[0][j] = p[0][j];
+        hp[1][j] = p[1][j];
+    }
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            p[i][j] -= gain[i][0] * hp[0][j] + gain[i][1] * hp[1][j];
+        }
+    }
+    *x = s[0];
+    *y = s[1];
+}
+
+FaceBoxCalculator::FaceBoxCalculator()
+    : position_filter(0.0001f, 0.001f), size_filter(0.0001f, 0.001f) {}
+
+void FaceBoxCalculator::GetContract(CalculatorContract *contract) const {
+    contract->Input<ColorImage>();
+    contract->Input<FaceDetections>();
+    contract->Output<FaceBox>();
+}
+
+bool FaceBoxCalculator::Process(const std::vector<Packet> &inputs,
+                                std::vector<Packet> &outputs) {
+    const cv::Mat &image = inputs[0].Get<ColorImage>().image;
+    const FaceDetections &detections = inputs[1].Get<FaceDetections>();
+    if (detections.empty()) {
+        return true;
+    }
+    // NEXT: only one face is detected
+    const FaceDetector::Box &best = detections[0];
+    int width = image.cols;
+    int height = image.rows;
+    FaceBox box;
+    box.score = best.score;
+    int x1 = best.x_min * width;
+    int y1 = best.y_min * height;
+    int x2 = (best.x_min + best.w) * width;
+    int y2 = (best.y_min + best.h) * height;
+    for (int i = 0; i < FaceDetectionSpec::kNumKeyPoints; i++) {
+        box.keypoints[i][0] = best.keypoints[i][0] * width;
+        box.keypoints[i][1] = best.keypoints[i][1] * height;
+    }
+    float x = x1, y = y1, w = x2 - x1, h = y2 - y1;
+    this->position_filter.Update(&x, &y);
+    this->size_filter.Update(&w, &h);
+    box.x_min = x;
+    box.y_min = y;
+    box.w = w;
+    box.h = h;
+    outputs[0] = Output(box);
+    return true;
+}
+
+void FaceRoiCalculator::GetContract(CalculatorContract *contract) const {
+    contract->Input<ColorImage>();
+    contract->Input<FaceBox>();
+    contract->Output<RoiImage>();
+    contract->Output<cv::Mat>();
+}
+
+// python's util.square_rect
+static void SquareRect(const FaceBox &box, int *x1, int *y1, int *x2,
+                       int *y2) {
+    int center_x = FloorDiv(2 * box.x_min + box.w, 2);
+    int center_y = FloorDiv(2 * box.y_min + box.h, 2);
+    int size = std::max(box.w, box.h);
+    *x1 = center_x - FloorDiv(size, 2);
+    *x2 = center_x + FloorDiv(size, 2);
+    *y1 = center_y - FloorDiv(size, 2);
+    *y2 = center_y + FloorDiv(size, 2);
+}
+
+// [left, right) x [top, bottom) clipped to the image, empty if nothing is
+// left
+static cv::Rect ClipRect(const cv::Mat &image, int left, int top, int right,
+                         int bottom) {
+    left = std::max(left, 0);
+    top = std::max(top, 0);
+    right = std::min(right, image.cols);
+    bottom = std::min(bottom, image.rows);
+    if (right <= left || bottom <= top) {
+        return cv::Rect();
+    }
+    return cv::Rect(left, top, right - left, bottom - top);
+}
+
+bool FaceRoiCalculator::Process(const std::vector<Packet> &inputs,
+                                std::vector<Packet> &outputs) {
+    TRACE_SCOPE("FaceRoiCalculator::Process");
+    const cv::Mat &image = inputs[0].Get<ColorImage>().image;
+    const FaceBox &box = inputs[1].Get<FaceBox>();
+    int x1, y1, x2, y2;
+    SquareRect(box, &x1, &y1, &x2, &y2);
+    const int *left_eye = box.keypoints[0];
+    const int *right_eye = box.keypoints[1];
+    double angle = std::atan2(right_eye[1] - left_eye[1],
+                              right_eye[0] - left_eye[0]) *
+                   57.3;
+
+    // face_roi: the square face with a quarter margin, rotated upright
+    // around the crop center, and the transform back to the image. the
+    // center is (rows / 2, cols / 2) like the python code, crops are square
+    int margin_w = FloorDiv(x2 - x1, 4);
+    int margin_h = FloorDiv(y2 - y1, 4);
+    cv::Rect rect = ClipRect(image, x1 - margin_w, y1 - margin_h,
+                             x2 + margin_w, y2 + margin_h);
+    if (rect.width > 0) {
+        cv::Mat crop = image(rect);
+        cv::Point2f center(crop.rows / 2.0f, crop.cols / 2.0f);
+        RoiImage roi;
+        cv::warpAffine(crop, roi.image,
+                       cv::getRotationMatrix2D(center, angle, 1),
+                       cv::Size(crop.cols, crop.rows));
+        // translation(x1 - margin_w, y1 - margin_h) @ rotation(-angle)
+        cv::Mat inverse = cv::getRotationMatrix2D(center, -angle, 1);
+        double offset[2] = {(double)x1 - margin_w, (double)y1 - margin_h};
+        for (int i = 0; i < 2; i++) {
+            for (int j = 0; j < 3; j++) {
+                roi.mat[i][j] = inverse.at<double>(i, j);
+            }
+            roi.mat[i][2] += offset[i];
+        }
+        roi.mat[2][0] = roi.mat[2][1] = 0;
+        roi.mat[2][2] = 1;
+        outputs[0] = Output(roi);
+    }
+
+    // face_roi_small: the square face shifted up by a tenth, cut from the
+    // whole image rotated upright around its (rows / 2, cols / 2). only
+    // the cut out part is warped, by shifting the rotation instead
+    int shift_y = FloorDiv(y2 - y1, 10);
+    rect = ClipRect(image, x1, y1 - shift_y, x2, y2 - shift_y);
+    if (rect.width > 0) {
+        cv::Mat rotation = cv::getRotationMatrix2D(
+            cv::Point2f(image.rows / 2.0f, image.cols / 2.0f), angle, 1);
+        rotation.at<double>(0, 2) -= rect.x;
+        rotation.at<double>(1, 2) -= rect.y;
+        cv::Mat small;
+        cv::warpAffine(image, small, rotation,
+                       cv::Size(rect.width, rect.height));
+        outputs[1] = Output(small);
+    }
+    return true;
+}
+
+bool BuildFaceGraph(Graph *graph, const std::string &source,
+                    const std::string &model_file, PixelFormat format) {
+    if (source.compare(0, 3, "inu") == 0 &&
+        (source.size() == 3 || source[3] == ':')) {
+        bool async = source.find(":async") != std::string::npos;
+        bool flip = source.find(":noflip") == std::string::npos;
+        InuCaptureCalculator *capture =
+            new InuCaptureCalculator(async, flip, format);
+        if (!capture->IsOpened()) {
+            delete capture;
+            return false;
+        }
+        graph->AddNode("capture", capture, {}, {"image", "depth"});
+    } else {
+        std::unique_ptr<FrameSource> frames = OpenFrameSource(source);
+        if (!frames) {
+            return false;
+        }
+        graph->AddNode("capture",
+                       new FrameSourceCalculator(std::move(frames), format),
+                       {}, {"image"});
+    }
+    // the graph runs its interpreters one after another, sharing a backend
+    // costs them nothing
+    NNTFLite::ShareCpuBackend(kNNThreads);
+    graph->AddNode("face_detection", new FaceDetectionCalculator(model_file),
+                   {"image"}, {"face_detections"});
+    graph->AddNode("face_box", new FaceBoxCalculator(),
+                   {"image", "face_detections"}, {"face_box"});
+    graph->AddNode("face_roi", new FaceRoiCalculator(), {"image", "face_box"},
+                   {"face_roi", "face_roi_small"});
+    return graph->Initialize();
+}
@@ -0,0 +1,133 @@
+// 2026-10-17 21:05
+#ifndef CALCULATORS_H
+#define CALCULATORS_H
+
+#include "detector.h"
+#include "face_payloads.h"
+#include "frame_source.h"
+#include "graph.h"
+#include "video_capture.h"
+
+// the native stages as graph calculators (graph.h) and the packet types
+// they exchange. the face path mirrors the Python face_detection app
+// (python/face_detection/face_detector.py): same box smoothing and the
+// same crops, so the Python consumers of its topics can't tell them apart.
+
+// 8UC3 in kPixelRGB or kPixelBGR order. owner keeps the pixels alive if
+// image points into a buffer it doesn't own (a sensor frame)
+struct ColorImage {
+    cv::Mat image;
+    PixelFormat format;
+    shared_ptr<const void> owner;
+};
+
+// 16U, registered to the ColorImage of the same frame
+struct DepthImage {
+    cv::Mat image;
+    shared_ptr<const void> owner;
+};
+
+// normalized to the image, best first
+typedef std::vector<FaceDetector::Box> FaceDetections;
+
+// the Inu sensor through VideoCapture::ReadRGBDFrame: outputs the color
+// image (format is kPixelRGB or kPixelBGR) and the depth image matched to
+// it (empty if none matched). the packets lease the RGBDFrame, the sensor
+// buffers are never copied
+class InuCaptureCalculator : public Calculator {
+   private:
+    VideoCapture capture;
+    PixelFormat format;
+
+   public:
+    InuCaptureCalculator(bool async, bool flip, PixelFormat format);
+    bool IsOpened() const { return this->capture.IsOpened(); }
+    void GetContract(CalculatorContract *contract) const override;
+    bool Process(const std::vector<Packet> &inputs,
+                 std::vector<Packet> &outputs) override;
+};
+
+// any other FrameSource, ends the graph when the source is exhausted. the
+// BGR frames are swapped to RGB if format asks for it
+class FrameSourceCalculator : public Calculator {
+   private:
+    std::unique_ptr<FrameSource> source;
+    PixelFormat format;
+
+   public:
+    FrameSourceCalculator(std::unique_ptr<FrameSource> source,
+                          PixelFormat format);
+    void GetContract(CalculatorContract *contract) const override;
+    bool Process(const std::vector<Packet> &inputs,
+                 std::vector<Packet> &outputs) override;
+};
+
+// ColorImage -> FaceDetections
+class FaceDetectionCalculator : public Calculator {
+   private:
+    FaceDetector detector;
+
+   public:
+    explicit FaceDetectionCalculator(const std::string &model_file);
+    void GetContract(CalculatorContract *contract) const override;
+    bool Process(const std::vector<Packet> &inputs,
+                 std::vector<Packet> &outputs) override;
+};
+
+// python's common.PointVelocityFilter: a constant velocity Kalman filter
+// of a 2D point, starting at (0, 0) at rest like cv2.KalmanFilter
+class PointVelocityFilter {
+   private:
+    // x, y, v_x, v_y and its covariance
+    float state[4];
+    float cov[4][4];
+    float cov_process;
+    float cov_measure;
+
+   public:
+    explicit PointVelocityFilter(float cov_process = 0.0001f,
+                                 float cov_measure = 0.0001f);
+    // predict, correct with the measured point, return the filtered point
+    void Update(float *x, float *y);
+};
+
+// ColorImage, FaceDetections -> FaceBox of the best face, empty if there
+// is none
+class FaceBoxCalculator : public Calculator {
+   private:
+    PointVelocityFilter position_filter;
+    PointVelocityFilter size_filter;
+
+   public:
+    FaceBoxCalculator();
+    void GetContract(CalculatorContract *contract) const override;
+    bool Process(const std::vector<Packet> &inputs,
+                 std::vector<Packet> &outputs) override;
+};
+
+// ColorImage, FaceBox -> the upright face with a margin for the landmark
+// model (RoiImage) and the tight upright face for face recognition
+// (cv::Mat)
+class FaceRoiCalculator : public Calculator {
+   public:
+    void GetContract(CalculatorContract *contract) const override;
+    bool Process(const std::vector<Packet> &inputs,
+                 std::vector<Packet> &outputs) override;
+};
+
+// the face path in one graph, streams named after the topics they
+// replace:
+//
+//   capture -> image -> face_detection -> face_detections
+//   image, face_detections -> face_box -> face_box
+//   image, face_box -> face_roi -> face_roi, face_roi_small
+//
+// plus `depth` from the sensor. source as for OpenFrameSource, "inu"
+// sources are read through InuCaptureCalculator. the images are in
+// `format` order. its interpreters run on the process-wide cpu backend
+// (NNTFLite::ShareCpuBackend) of kNNThreads workers. false if the source
+// can't be opened
+bool BuildFaceGraph(Graph *graph, const std::string &source,
+                    const std::string &model_file, PixelFormat format);
+
+#endif  // CALCULATORS_H
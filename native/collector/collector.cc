@@ -0,0 +1,270 @@
+#include "collector.h"
+
+#include <unistd.h>
+#include <zmq.h>
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+#include "../json.h"
+
+using namespace std::chrono;
+
+// latencies are recorded in us, up to a minute with 1% precision
+const int64_t kHighestUs = 60000000;
+const int kSignificantDigits = 2;
+// larger parts (the payloads) aren't kept
+const size_t kMaxPartSize = 256;
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static int64_t NowNs() {
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())
+        .count();
+}
+
+TopicLatency::TopicLatency()
+    : capture_publish(kHighestUs, kSignificantDigits),
+      stage(kHighestUs, kSignificantDigits),
+      publish_consume(kHighestUs, kSignificantDigits),
+      capture_consume(kHighestUs, kSignificantDigits) {}
+
+Collector::Collector(const CollectorConfig &config)
+    : config(config),
+      ctx(zmq_ctx_new()),
+      subscriber(nullptr),
+      latency_socket(nullptr),
+      stats_socket(nullptr),
+      id("*collector." + std::to_string(getpid())),
+      start_time(NowNs()) {}
+
+Collector::~Collector() {
+    for (void *socket :
+         {this->subscriber, this->latency_socket, this->stats_socket}) {
+        if (socket) {
+            zmq_close(socket);
+        }
+    }
+    zmq_ctx_term(this->ctx);
+}
+
+bool Collector::Open() {
+    int linger = 0;
+    this->subscriber = zmq_socket(this->ctx, ZMQ_SUB);
+    this->latency_socket = zmq_socket(this->ctx, ZMQ_PULL);
+    this->stats_socket = zmq_socket(this->ctx, ZMQ_REP);
+    for (void *socket :
+         {this->subscriber, this->latency_socket, this->stats_socket}) {
+        zmq_setsockopt(socket, ZMQ_LINGER, &linger, sizeof(linger));
+    }
+    // every topic: the Python proxy goes by the first, the native broker
+    // by the second and sends them as \0 id \0 topic. the id makes us a
+    // monitor, which it doesn't pace
+    std::string named = '\0' + this->id + '\0';
+    zmq_setsockopt(this->subscriber, ZMQ_SUBSCRIBE, "", 0);
+    zmq_setsockopt(this->subscriber, ZMQ_SUBSCRIBE, named.data(),
+                   named.size());
+    if (zmq_connect(this->subscriber, this->config.outbound.c_str()) != 0) {
+        std::cout << "Failed to connect to " << this->config.outbound << ": "
+                  << zmq_strerror(zmq_errno()) << std::endl;
+        return false;
+    }
+    const std::pair<void *, const std::string *> binds[] = {
+        {this->latency_socket, &this->config.latency},
+        {this->stats_socket, &this->config.stats},
+    };
+    for (const auto &bind : binds) {
+        if (zmq_bind(bind.first, bind.second->c_str()) != 0) {
+            std::cout << "Failed to bind " << *bind.second << ": "
+                      << zmq_strerror(zmq_errno()) << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// a multipart message into parts, the ones larger than kMaxPartSize empty.
+// the number of parts, -1 on an error (EAGAIN if there is no message)
+static int RecvParts(void *socket, std::vector<std::string> *parts) {
+    int count = 0;
+    bool more = true;
+    while (more) {
+        zmq_msg_t msg;
+        zmq_msg_init(&msg);
+        if (zmq_msg_recv(&msg, socket, count == 0 ? ZMQ_DONTWAIT : 0) < 0) {
+            zmq_msg_close(&msg);
+            return -1;
+        }
+        if ((int)parts->size() <= count) {
+            parts->emplace_back();
+        }
+        size_t size = zmq_msg_size(&msg);
+        if (size <= kMaxPartSize) {
+            (*parts)[count].assign((const char *)zmq_msg_data(&msg), size);
+        } else {
+            (*parts)[count].clear();
+        }
+        count++;
+        more = zmq_msg_more(&msg);
+        zmq_msg_close(&msg);
+    }
+    return count;
+}
+
+static bool ParseOrigin(const std::string &part, MessageOrigin *origin) {
+    if (part.size() != sizeof(MessageOrigin)) {
+        return false;
+    }
+    memcpy(origin, part.data(), sizeof(MessageOrigin));
+    return true;
+}
+
+static void RecordNs(HdrHistogram *histogram, int64_t ns) {
+    histogram->Record(ns / 1000);
+}
+
+// [topic, payload, origin] of every topic
+bool Collector::ReadMessages() {
+    for (int i = 0; i < 256; i++) {
+        int size = RecvParts(this->subscriber, &this->parts);
+        if (size < 0) {
+            return zmq_errno() == EAGAIN;
+        }
+        MessageOrigin origin;
+        if (size != 3 || !ParseOrigin(this->parts[2], &origin)) {
+            continue;
+        }
+        std::string &topic = this->parts[0];
+        size_t end = topic.find('\0');
+        size_t id_end = end == std::string::npos
+                            ? end
+                            : topic.find('\0', end + 1);
+        if (id_end != std::string::npos) {
+            // prefix \0 id \0 rest, the prefix is empty
+            topic.erase(end, id_end + 1 - end);
+        }
+        TopicLatency &latency = this->topics[topic];
+        RecordNs(&latency.capture_publish,
+                 origin.publish_ns - origin.capture_ns);
+        RecordNs(&latency.stage, origin.publish_ns - origin.received_ns);
+    }
+    return true;
+}
+
+// [topic, origin, consumed_ns] of the apps' subscribers
+bool Collector::ReadReports() {
+    for (int i = 0; i < 256; i++) {
+        int size = RecvParts(this->latency_socket, &this->parts);
+        if (size < 0) {
+            return zmq_errno() == EAGAIN;
+        }
+        MessageOrigin origin;
+        int64_t consumed_ns;
+        if (size != 3 || !ParseOrigin(this->parts[1], &origin) ||
+            this->parts[2].size() != sizeof(consumed_ns)) {
+            continue;
+        }
+        memcpy(&consumed_ns, this->parts[2].data(), sizeof(consumed_ns));
+        TopicLatency &latency = this->topics[this->parts[0]];
+        RecordNs(&latency.publish_consume, consumed_ns - origin.publish_ns);
+        RecordNs(&latency.capture_consume, consumed_ns - origin.capture_ns);
+    }
+    return true;
+}
+
+bool Collector::ServeStats() {
+    int size = RecvParts(this->stats_socket, &this->parts);
+    if (size < 0) {
+        return zmq_errno() == EAGAIN;
+    }
+    std::string json = StatsJson();
+    if (this->parts[0] == "reset") {
+        Reset();
+    }
+    return zmq_send(this->stats_socket, json.data(), json.size(), 0) >= 0;
+}
+
+void Collector::Run() {
+    zmq_pollitem_t items[] = {
+        {this->latency_socket, 0, ZMQ_POLLIN, 0},
+        {this->subscriber, 0, ZMQ_POLLIN, 0},
+        {this->stats_socket, 0, ZMQ_POLLIN, 0},
+    };
+    while (!stop_requested) {
+        // a timeout, so Stop() is seen while nothing is published
+        if (zmq_poll(items, 3, 1000) < 0) {
+            if (zmq_errno() == EINTR) {
+                continue;
+            }
+            std::cout << "zmq_poll: " << zmq_strerror(zmq_errno())
+                      << std::endl;
+            return;
+        }
+        bool ok = true;
+        if (items[0].revents & ZMQ_POLLIN) {
+            ok = ReadReports();
+        }
+        if (ok && (items[1].revents & ZMQ_POLLIN)) {
+            ok = ReadMessages();
+        }
+        if (ok && (items[2].revents & ZMQ_POLLIN)) {
+            ok = ServeStats();
+        }
+        if (!ok) {
+            std::cout << "collector: " << zmq_strerror(zmq_errno())
+                      << std::endl;
+            return;
+        }
+    }
+}
+
+void Collector::Stop() { stop_requested = 1; }
+
+void Collector::Reset() {
+    for (auto &topic : this->topics) {
+        for (HdrHistogram *histogram :
+             {&topic.second.capture_publish, &topic.second.stage,
+              &topic.second.publish_consume, &topic.second.capture_consume}) {
+            histogram->Reset();
+        }
+    }
+    this->start_time = NowNs();
+}
+
+static void JsonHistogram(std::ostream &out, const char *name,
+                          const HdrHistogram &histogram) {
+    out << '"' << name << "\": {\"count\": " << histogram.Count()
+        << ", \"mean\": " << histogram.Mean()
+        << ", \"p50\": " << histogram.ValueAtPercentile(50)
+        << ", \"p90\": " << histogram.ValueAtPercentile(90)
+        << ", \"p99\": " << histogram.ValueAtPercentile(99)
+        << ", \"max\": " << histogram.Max() << "}";
+}
+
+std::string Collector::StatsJson() const {
+    std::ostringstream out;
+    out << "{\"uptime_s\": " << (NowNs() - this->start_time) / 1e9
+        << ", \"topics\": {";
+    bool first = true;
+    for (const auto &topic : this->topics) {
+        const TopicLatency &latency = topic.second;
+        out << (first ? "" : ", ");
+        first = false;
+        JsonBytes(out, topic.first);
+        out << ": {";
+        JsonHistogram(out, "capture_publish", latency.capture_publish);
+        out << ", ";
+        JsonHistogram(out, "stage", latency.stage);
+        out << ", ";
+        JsonHistogram(out, "publish_consume", latency.publish_consume);
+        out << ", ";
+        JsonHistogram(out, "capture_consume", latency.capture_consume);
+        out << "}";
+    }
+    out << "}}";
+    return out.str();
+}
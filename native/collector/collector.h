@@ -0,0 +1,92 @@
+// 2026-10-17 23:58
+#ifndef COLLECTOR_COLLECTOR_H
+#define COLLECTOR_COLLECTOR_H
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "histogram.h"
+
+// the end to end latencies of the Python apps' messages
+// (python/message_broker), in its own process while tuning.
+//
+// every message is [topic, payload, origin]: origin is the MessageOrigin of
+// the frame the message was derived from. the collector subscribes to every
+// topic (a monitor of the native broker, see broker/broker.h, so it doesn't
+// change the pacing it measures), and the apps' subscribers report each
+// message they consumed on the latency socket as [topic, origin,
+// consumed_ns]. per topic it keeps HdrHistograms of
+//
+//   capture_publish  the frame was captured -> the message was published
+//   stage            the publishing stage got its input -> published
+//   publish_consume  published -> a subscriber's callback returned
+//   capture_consume  captured -> a subscriber's callback returned
+//
+// in microseconds, all times are CLOCK_MONOTONIC (steady_clock,
+// time.monotonic_ns) ns of the host. they are served as JSON on the stats
+// socket, a REP socket answering any request. the request "reset" clears
+// them after the answer:
+//
+//   {"uptime_s": 12.5,
+//    "topics": {"face_landmark": {"capture_publish": {"count": 300,
+//               "mean": 41210.5, "p50": 40959, "p90": 47103, "p99": 60415,
+//               "max": 61022}, "stage": {...}, ...}, ...}}
+
+// the last part of every message, packed little endian
+struct MessageOrigin {
+    // unique across the publishing processes, the pid in the upper 32 bits
+    int64_t frame_id;
+    int64_t capture_ns;
+    // when the stage that published the message got its input
+    int64_t received_ns;
+    int64_t publish_ns;
+};
+
+struct TopicLatency {
+    HdrHistogram capture_publish;
+    HdrHistogram stage;
+    HdrHistogram publish_consume;
+    HdrHistogram capture_consume;
+    TopicLatency();
+};
+
+struct CollectorConfig {
+    std::string outbound;
+    std::string latency;
+    std::string stats;
+};
+
+class Collector {
+   private:
+    CollectorConfig config;
+    void *ctx;
+    void *subscriber;
+    void *latency_socket;
+    void *stats_socket;
+    // as a monitor of the native broker
+    std::string id;
+    // sorted for the stats
+    std::map<std::string, TopicLatency> topics;
+    // of the last message, reused
+    std::vector<std::string> parts;
+    int64_t start_time;
+    bool ReadMessages();
+    bool ReadReports();
+    bool ServeStats();
+
+   public:
+    explicit Collector(const CollectorConfig &config);
+    ~Collector();
+    // false (with the reason printed) if a socket couldn't be bound
+    bool Open();
+    // until Stop() or a socket error
+    void Run();
+    // async signal safe
+    static void Stop();
+    std::string StatsJson() const;
+    void Reset();
+};
+
+#endif  // COLLECTOR_COLLECTOR_H
@@ -0,0 +1,79 @@
+#include "histogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+HdrHistogram::HdrHistogram(int64_t highest, int significant_digits)
+    : highest(std::max<int64_t>(highest, 1)) {
+    // values below 2 * 10^digits get a sub bucket each
+    double single_unit = 2 * std::pow(10, significant_digits);
+    this->sub_bucket_bits = (int)std::ceil(std::log2(single_unit));
+    this->sub_bucket_half_bits = this->sub_bucket_bits - 1;
+    this->sub_bucket_mask = ((int64_t)1 << this->sub_bucket_bits) - 1;
+    int buckets = 1;
+    int64_t untrackable = (int64_t)1 << this->sub_bucket_bits;
+    while (untrackable <= this->highest) {
+        buckets++;
+        if (untrackable > INT64_MAX / 2) {
+            break;
+        }
+        untrackable <<= 1;
+    }
+    this->counts.resize((size_t)(buckets + 1) << this->sub_bucket_half_bits);
+    Reset();
+}
+
+int HdrHistogram::Index(int64_t value) const {
+    // the first bucket has all its sub buckets, the others the upper half
+    int pow2_ceiling = 64 - __builtin_clzll(value | this->sub_bucket_mask);
+    int bucket = pow2_ceiling - this->sub_bucket_half_bits - 1;
+    int64_t sub_bucket = value >> bucket;
+    return ((bucket + 1) << this->sub_bucket_half_bits) +
+           (int)(sub_bucket - ((int64_t)1 << this->sub_bucket_half_bits));
+}
+
+int64_t HdrHistogram::HighestAt(int index) const {
+    int64_t half = (int64_t)1 << this->sub_bucket_half_bits;
+    int bucket = (index >> this->sub_bucket_half_bits) - 1;
+    int64_t sub_bucket = (index & (half - 1)) + half;
+    if (bucket < 0) {
+        sub_bucket -= half;
+        bucket = 0;
+    }
+    return (sub_bucket << bucket) + ((int64_t)1 << bucket) - 1;
+}
+
+void HdrHistogram::Record(int64_t value) {
+    value = std::min(std::max<int64_t>(value, 0), this->highest);
+    this->counts[Index(value)]++;
+    this->total++;
+    this->min = std::min(this->min, value);
+    this->max = std::max(this->max, value);
+    this->sum += value;
+}
+
+void HdrHistogram::Reset() {
+    std::fill(this->counts.begin(), this->counts.end(), 0);
+    this->total = 0;
+    this->min = this->highest;
+    this->max = 0;
+    this->sum = 0;
+}
+
+int64_t HdrHistogram::ValueAtPercentile(double percentile) const {
+    if (this->total == 0) {
+        return 0;
+    }
+    double fraction = std::min(std::max(percentile, 0.0), 100.0) / 100;
+    uint64_t rank =
+        std::max<uint64_t>(1, (uint64_t)std::ceil(fraction * this->total));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < this->counts.size(); i++) {
+        seen += this->counts[i];
+        if (seen >= rank) {
+            // the bucket's upper end, the max is exact
+            return std::min(HighestAt(i), this->max);
+        }
+    }
+    return this->max;
+}
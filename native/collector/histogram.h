@@ -0,0 +1,44 @@
+// 2026-10-17 23:58
+#ifndef COLLECTOR_HISTOGRAM_H
+#define COLLECTOR_HISTOGRAM_H
+
+#include <cstdint>
+#include <vector>
+
+// a high dynamic range histogram (the HdrHistogram layout): values from 0
+// to highest in buckets of powers of two, each split into linear sub
+// buckets, so every value is kept with the given number of significant
+// decimal digits at a fixed, small size and Record() is a few instructions.
+// values below 0 are counted as 0, above highest as highest
+class HdrHistogram {
+   private:
+    int64_t highest;
+    // log2 of the sub buckets per bucket, of half of them
+    int sub_bucket_bits;
+    int sub_bucket_half_bits;
+    int64_t sub_bucket_mask;
+    std::vector<uint64_t> counts;
+    uint64_t total;
+    int64_t min;
+    int64_t max;
+    double sum;
+    int Index(int64_t value) const;
+    // the largest value counted at index
+    int64_t HighestAt(int index) const;
+
+   public:
+    // significant_digits from 1 to 5
+    HdrHistogram(int64_t highest, int significant_digits);
+    void Record(int64_t value);
+    void Reset();
+    uint64_t Count() const { return this->total; }
+    // 0 if empty
+    int64_t Min() const { return this->total ? this->min : 0; }
+    int64_t Max() const { return this->total ? this->max : 0; }
+    double Mean() const { return this->total ? this->sum / this->total : 0; }
+    // the value percentile (0 to 100) percent of the values are at or below,
+    // within the precision. 0 if empty
+    int64_t ValueAtPercentile(double percentile) const;
+};
+
+#endif  // COLLECTOR_HISTOGRAM_H
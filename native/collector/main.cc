@@ -0,0 +1,32 @@
+// the latency collector for python/message_broker, see collector.h. run it
+// next to the apps while tuning, python -m message_broker.latency prints
+// what it collected
+//
+// usage: collector.elf [outbound latency stats]
+#include <csignal>
+#include <iostream>
+
+#include "collector.h"
+
+static void OnSignal(int) { Collector::Stop(); }
+
+int main(int argc, char *argv[]) {
+    if (argc != 1 && argc != 4) {
+        std::cout << "usage: " << argv[0]
+                  << " [outbound latency stats]" << std::endl;
+        return -1;
+    }
+    CollectorConfig config;
+    config.outbound = argc > 1 ? argv[1] : "tcp://127.0.0.1:5556";
+    config.latency = argc > 2 ? argv[2] : "tcp://127.0.0.1:5559";
+    config.stats = argc > 3 ? argv[3] : "tcp://127.0.0.1:5560";
+
+    Collector collector(config);
+    if (!collector.Open()) {
+        return -1;
+    }
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+    collector.Run();
+    return 0;
+}
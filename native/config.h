@@ -2,16 +2,11 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
-#define kMinScoreThresh 0.68
-#define kNMSThresh 0.5
-#define kNumBoxes 896
-#define kNumCoords 16
-#define kNumKeyPoints 6
-#define kOutputSize kNumBoxes*(kNumCoords + 1)
-#define kImageHeight 128
-#define kImageWidth 128
-#define kImageSize kImageHeight* kImageWidth * 3
-#define kModelFileName \
-    "/home/sunway/source/mediapipe-demo/model/face_detection_front.tflite"
+#define kModelDir "/home/sunway/source/mediapipe-demo/model/"
+#define kFaceDetectionModel kModelDir "face_detection_front.tflite"
+#define kPalmDetectionModel kModelDir "palm_detection.tflite"
+
+// workers of the cpu backend the native pipelines' interpreters share
+#define kNNThreads 2
 
 #endif  // CONFIG_H
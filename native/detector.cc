@@ -1,72 +1,54 @@
 #include "detector.h"
 
-Detector::Detector()
-    : nn_input(new float[kImageSize]),
-      nn_output(new float[kOutputSize]),
-      nn(nn_input, nn_output) {
-    gen_anchors();
-}
+#include "trace.h"
 
-Eigen::ArrayXf sigmoid(Eigen::ArrayXf input) {
-    return 1.0 / (1.0 + 1.0 / input.exp());
+static bool CheckTensor(const TensorInfo &tensor,
+                        const std::vector<int> &shape) {
+    return tensor.type == kTfLiteFloat32 && tensor.shape == shape;
 }
 
-void Detector::gen_anchors() {
-    // stide = 8
-    int height = std::ceil(1.0 * kImageHeight / 8);
-    int width = std::ceil(1.0 * kImageWidth / 8);
-
-    int anchor_index = 0;
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            for (int i = 0; i < 2; i++) {
-                float x_center = (x + 0.5) / width;
-                float y_center = (y + 0.5) / height;
-                float w = 1.0;
-                float h = 1.0;
-                this->anchors[anchor_index++] =
-                    Anchor{x_center, y_center, w, h};
-            }
-        }
+template <typename Spec>
+SsdDetector<Spec>::SsdDetector(const std::string &model_file,
+                               int max_detections, NMSMode nms_mode,
+                               ArenaGroup *arena_group)
+    : nn(model_file, arena_group),
+      preprocessor(Spec::kInputWidth, Spec::kInputHeight),
+      decoder(max_detections, nms_mode),
+      timing() {
+    if (this->nn.NumInputs() != 1 || this->nn.NumOutputs() != 2 ||
+        !CheckTensor(this->nn.Input(0),
+                     {1, Spec::kInputHeight, Spec::kInputWidth, 3}) ||
+        !CheckTensor(this->nn.Output(0), {1, kNumBoxes, Spec::kNumCoords}) ||
+        !CheckTensor(this->nn.Output(1), {1, kNumBoxes, 1})) {
+        std::cout << model_file << " doesn't match the detector spec"
+                  << std::endl;
+        exit(-1);
     }
-    // stide = 16
-    height = std::ceil(1.0 * kImageHeight / 16);
-    width = std::ceil(1.0 * kImageWidth / 16);
+}
 
-    for (int y = 0; y < height; y++) {
-        for (int x = 0; x < width; x++) {
-            for (int i = 0; i < 6; i++) {
-                float x_center = (x + 0.5) / width;
-                float y_center = (y + 0.5) / height;
-                float w = 1.0;
-                float h = 1.0;
-                this->anchors[anchor_index++] =
-                    Anchor{x_center, y_center, w, h};
-            }
-        }
-    }
+static double ElapsedUs(steady_clock::time_point start,
+                        steady_clock::time_point end) {
+    return duration_cast<nanoseconds>(end - start).count() / 1000.0;
 }
 
-vector<Box> Detector::Detect(cv::Mat input_img) {
-    cv::Mat img;
-    // convert to rgb
-    cv::cvtColor(input_img, img, cv::COLOR_BGR2RGB);
-    // resize
-    ResizedImage resized_image =
-        ResizeAndKeepAspectRatio(img, kImageWidth, kImageHeight);
-    img = resized_image.img;
-    float h_padding = resized_image.h_padding;
-    float v_padding = resized_image.v_padding;
-    // convert 8UC3 to float32 (-1,1)
-    img.convertTo(img, CV_32F, 1.0 / 127.5, -1);
-    int total_size = img.cols * img.rows * img.elemSize();
-    memcpy(this->nn_input, img.data, total_size);
+template <typename Spec>
+std::vector<typename SsdDetector<Spec>::Box> SsdDetector<Spec>::Detect(
+    cv::Mat input_img, PixelFormat format) {
+    TRACE_SCOPE("Detector::Detect");
+    const int kImageWidth = Spec::kInputWidth;
+    const int kImageHeight = Spec::kInputHeight;
+    steady_clock::time_point start = steady_clock::now();
+    // letterbox, convert to rgb and normalize to float32 (-1,1) in one pass,
+    // written straight into the input tensor
+    LetterboxPadding padding = this->preprocessor.Run(
+        input_img, format, this->nn.InputTensor<float>(0));
+    float h_padding = padding.h_padding;
+    float v_padding = padding.v_padding;
+    steady_clock::time_point preprocessed = steady_clock::now();
     this->nn.Invoke();
-    float *raw_boxes = this->nn_output;
-    Eigen::Map<Eigen::ArrayXf> scores(this->nn_output + kNumBoxes * kNumCoords,
-                                      kNumBoxes);
-
-    scores = sigmoid(scores);
+    steady_clock::time_point invoked = steady_clock::now();
+    const float *raw_boxes = this->nn.OutputTensor<float>(0);
+    const float *raw_scores = this->nn.OutputTensor<float>(1);
 
     auto restore_x = [h_padding](float x) -> float {
         return (x - h_padding) * kImageWidth /
@@ -83,7 +65,9 @@ vector<Box> Detector::Detect(cv::Mat input_img) {
         return h * kImageHeight / ((1 - 2 * v_padding) * kImageHeight);
     };
 
-    std::vector<Box> boxes = NMS(Calibrate(raw_boxes, scores.data()));
+    this->decoder.Calibrate(raw_boxes, raw_scores);
+    steady_clock::time_point decoded = steady_clock::now();
+    std::vector<Box> boxes = this->decoder.NMS();
     for (auto &box : boxes) {
         box.x_min = restore_x(box.x_min);
         box.y_min = restore_y(box.y_min);
@@ -94,69 +78,13 @@ vector<Box> Detector::Detect(cv::Mat input_img) {
             point[1] = restore_y(point[1]);
         }
     }
+    steady_clock::time_point end = steady_clock::now();
+    this->timing.preprocess_us = ElapsedUs(start, preprocessed);
+    this->timing.invoke_us = ElapsedUs(preprocessed, invoked);
+    this->timing.decode_us = ElapsedUs(invoked, decoded);
+    this->timing.nms_us = ElapsedUs(decoded, end);
     return boxes;
 }
 
-std::vector<Box> Detector::Calibrate(float *raw_boxes, float *scores) {
-    std::vector<Box> ret;
-    for (int i = 0; i < kNumBoxes; i++) {
-        float *raw_box = raw_boxes + i * kNumCoords;
-        Anchor &anchor = this->anchors[i];
-        float score = scores[i];
-        if (score < kMinScoreThresh) {
-            continue;
-        }
-        float x_center = raw_box[0];
-        float y_center = raw_box[1];
-        float w = raw_box[2];
-        float h = raw_box[3];
-        x_center = x_center / kImageWidth * anchor.w + anchor.x_center;
-        y_center = y_center / kImageHeight * anchor.h + anchor.y_center;
-        w = w / kImageWidth * anchor.w;
-        h = h / kImageHeight * anchor.h;
-
-        Box box{score, x_center - w / 2, y_center - h / 2, w, h};
-        for (int i = 0; i < kNumKeyPoints; i++) {
-            box.keypoints[i][0] =
-                raw_box[4 + i * 2] / kImageWidth + anchor.x_center;
-            box.keypoints[i][1] =
-                raw_box[4 + i * 2 + 1] / kImageHeight + anchor.y_center;
-        }
-        ret.push_back(box);
-    }
-    return ret;
-}
-
-vector<Box> Detector::NMS(vector<Box> boxes) {
-    vector<Box> picked;
-    std::sort(
-        boxes.begin(), boxes.end(),
-        [](const Box &a, const Box &b) -> bool { return a.score > b.score; });
-
-    bool supressed[boxes.size()] = {};
-    for (size_t i = 0; i < boxes.size(); i++) {
-        if (supressed[i]) {
-            continue;
-        }
-        Box &best = boxes[i];
-        picked.push_back(best);
-        for (size_t j = i + 1; j < boxes.size(); j++) {
-            float iou = IOU(best, boxes[j]);
-            if (iou >= kNMSThresh) {
-                supressed[j] = true;
-            }
-        }
-    }
-    return picked;
-}
-
-float Detector::IOU(const Box &a, const Box &b) {
-    float x1 = std::max(a.x_min, b.x_min);
-    float y1 = std::max(a.y_min, b.y_min);
-    float x2 = std::min(a.x_min + a.w, b.x_min + b.w);
-    float y2 = std::min(a.y_min + a.h, b.y_min + b.h);
-    float w = std::max(0.0f, x2 - x1);
-    float h = std::max(0.0f, y2 - y1);
-    float intersection = w * h;
-    return intersection / (a.w * a.h + b.w * b.h - intersection);
-}
+template class SsdDetector<FaceDetectionSpec>;
+template class SsdDetector<PalmDetectionSpec>;
@@ -1,38 +1,47 @@
 // 2021-01-04 14:01
 #ifndef DETECTOR_H
 #define DETECTOR_H
-#include "Eigen/Eigen"
 #include "common.h"
+#include "preprocess.h"
+#include "ssd_decoder.h"
+#include "ssd_spec.h"
 #include "tflite/nn_tflite.h"
 #include "util.h"
 
-struct Box {
-    float score;
-    float x_min, y_min;
-    float w, h;
-    float keypoints[kNumKeyPoints][2];
+// wall time of the stages of the last Detect() call, in microseconds
+struct DetectTiming {
+    double preprocess_us;
+    double invoke_us;
+    double decode_us;
+    double nms_us;
 };
 
-struct Anchor {
-    float x_center, y_center;
-    float w, h;
-};
+// Spec (see ssd_spec.h) fixes every size at compile time: the anchors are
+// a constexpr table and the decode loops are fully unrolled per model
+// (SsdDecoder)
+template <typename Spec>
+class SsdDetector {
+   public:
+    static constexpr int kNumBoxes = SsdDecoder<Spec>::kNumBoxes;
+    typedef typename SsdDecoder<Spec>::Box Box;
 
-class Detector {
    private:
-    float *nn_input;
-    float *nn_output;
     NNTFLite nn;
-    Anchor anchors[kNumBoxes];
-    std::vector<Box> boxes;
-    void gen_anchors();
-    std::vector<Box> NMS(std::vector<Box>);
-    std::vector<Box> Calibrate(float *raw_boxes, float *score);
-    static float IOU(const Box &a, const Box &b);
+    Preprocessor preprocessor;
+    SsdDecoder<Spec> decoder;
+    DetectTiming timing;
 
    public:
-    Detector();
-    std::vector<Box> Detect(cv::Mat img);
+    // model_file must have the tensor shapes described by Spec,
+    // max_detections <= 0 keeps every box that survives NMS
+    explicit SsdDetector(const std::string &model_file = Spec::kModelFileName,
+                         int max_detections = 0, NMSMode nms_mode = kNMSHard,
+                         ArenaGroup *arena_group = nullptr);
+    std::vector<Box> Detect(cv::Mat img, PixelFormat format = kPixelBGR);
+    const DetectTiming &LastTiming() const { return this->timing; }
 };
 
+typedef SsdDetector<FaceDetectionSpec> FaceDetector;
+typedef SsdDetector<PalmDetectionSpec> PalmDetector;
+
 #endif  // DETECTOR_H
@@ -1,6 +1,8 @@
 #include "detector.h"
-#include "video_capture.h"
+#include "frame_source.h"
+#include "trace.h"
 
+template <typename Box>
 void AnnotateImage(cv::Mat img, std::vector<Box> boxes) {
     int height = img.rows;
     int width = img.cols;
@@ -25,19 +27,38 @@ void AnnotateImage(cv::Mat img, std::vector<Box> boxes) {
 }
 
 int main(int argc, char *argv[]) {
-    VideoCapture capture;
-    Detector detector;
+    // face_detector.elf [face_detection_front.tflite] [source [fps]]
+    // source: inu[:async][:noflip], synthetic[:WxH], file.rgbd, an image
+    // directory or a video file (see OpenFrameSource)
+    // fps 0 reads file sources as fast as possible
+    std::unique_ptr<FrameSource> capture = OpenFrameSource(
+        argc > 2 ? argv[2] : "inu", argc > 3 ? atof(argv[3]) : -1);
+    if (!capture) {
+        return -1;
+    }
+    NNTFLite::ShareCpuBackend(kNNThreads);
+    FaceDetector detector(argc > 1 ? argv[1] : kFaceDetectionModel);
 
     cv::namedWindow("test", cv::WINDOW_NORMAL);
-    while (true) {
-        cv::Mat img = capture.ReadBGRImage();
-        // cv::Mat depth_img = capture.ReadDepthImage();
-        std::vector<Box> boxes = detector.Detect(img);
-        AnnotateImage(img, boxes);
-        cv::imshow("test", img);
+    for (int64_t frame_id = 0;; frame_id++) {
+        TRACE_FRAME(frame_id);
+        cv::Mat img = capture->ReadBGRImage();
+        if (img.empty()) {
+            break;
+        }
+        // cv::Mat depth_img = capture->ReadDepthImage();
+        std::vector<FaceDetector::Box> boxes = detector.Detect(img);
+        // frames are read only, see FrameSource
+        cv::Mat annotated = img.clone();
+        AnnotateImage(annotated, boxes);
+        cv::imshow("test", annotated);
         if ((cv::waitKey(1) & 0xff) == 0x71) {
             break;
         }
     }
     cv::destroyWindow("test");
+    std::string report = capture->Report();
+    if (!report.empty()) {
+        std::cout << report << std::endl;
+    }
 }
@@ -0,0 +1,28 @@
+// 2026-10-17 23:59
+#ifndef FACE_PAYLOADS_H
+#define FACE_PAYLOADS_H
+
+#include <opencv2/core/core.hpp>
+
+#include "ssd_spec.h"
+
+// the face path's results that leave the graph as topics: the packets of
+// calculators.h and the payloads of topic_codec.h, kept apart from both so
+// the codec doesn't depend on the detector and the graph
+
+// the best face in image pixels, position and size smoothed over time
+struct FaceBox {
+    float score;
+    int x_min, y_min;
+    int w, h;
+    int keypoints[FaceDetectionSpec::kNumKeyPoints][2];
+};
+
+// a crop of the image and the homogeneous transform from crop to image
+// pixel coordinates, python's util.ROIImage
+struct RoiImage {
+    cv::Mat image;
+    double mat[3][3];
+};
+
+#endif  // FACE_PAYLOADS_H
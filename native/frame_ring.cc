@@ -0,0 +1,174 @@
+#include "frame_ring.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+
+static size_t AlignUp(size_t size) {
+    return (size + kFrameRingAlignment - 1) / kFrameRingAlignment *
+           kFrameRingAlignment;
+}
+
+// shm_open wants "/name"
+static std::string ShmName(const std::string &name) {
+    return name[0] == '/' ? name : "/" + name;
+}
+
+static FrameRingSlot *Slot(uint8_t *data, uint32_t i) {
+    const FrameRingHeader *header = (const FrameRingHeader *)data;
+    return (FrameRingSlot *)(data + kFrameRingAlignment +
+                             i * header->slot_stride);
+}
+
+FrameRingWriter::FrameRingWriter(const std::string &name, int num_slots,
+                                 size_t slot_size)
+    : name(ShmName(name)), data(nullptr), size(0), next_slot(0) {
+    size_t slot_stride = kFrameRingAlignment + AlignUp(slot_size);
+    size_t size = kFrameRingAlignment + num_slots * slot_stride;
+    // a new object rather than truncating the old one under its readers
+    shm_unlink(this->name.c_str());
+    int fd = shm_open(this->name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0 || ftruncate(fd, size) != 0) {
+        std::cout << "Failed to create frame ring " << name << std::endl;
+        if (fd >= 0) {
+            close(fd);
+            shm_unlink(this->name.c_str());
+        }
+        return;
+    }
+    void *mapping =
+        mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cout << "Failed to map frame ring " << name << std::endl;
+        shm_unlink(this->name.c_str());
+        return;
+    }
+    this->data = (uint8_t *)mapping;
+    this->size = size;
+
+    // ftruncate zeroed it: every slot is empty at sequence 0
+    FrameRingHeader *header = (FrameRingHeader *)this->data;
+    memcpy(header->magic, kFrameRingMagic, sizeof(header->magic));
+    header->version = 1;
+    header->num_slots = num_slots;
+    header->slot_size = slot_size;
+    header->slot_stride = slot_stride;
+    header->instance = duration_cast<nanoseconds>(
+                           system_clock::now().time_since_epoch())
+                           .count();
+}
+
+FrameRingWriter::~FrameRingWriter() {
+    if (this->data) {
+        munmap(this->data, this->size);
+        shm_unlink(this->name.c_str());
+    }
+}
+
+size_t FrameRingWriter::SlotSize() const {
+    return ((const FrameRingHeader *)this->data)->slot_size;
+}
+
+bool FrameRingWriter::Write(const cv::Mat &image, FrameRingRef *ref) {
+    const FrameRingHeader *header = (const FrameRingHeader *)this->data;
+    size_t row_size = image.cols * image.elemSize();
+    if (row_size * image.rows > header->slot_size) {
+        return false;
+    }
+    for (uint32_t tries = 0; tries < header->num_slots; tries++) {
+        uint32_t i = this->next_slot;
+        this->next_slot = (i + 1) % header->num_slots;
+        FrameRingSlot *slot = Slot(this->data, i);
+        // only this writer changes seq
+        uint64_t seq = slot->seq.load(std::memory_order_relaxed);
+        // seq_cst store then load, against the reader's pin then check
+        slot->seq.store(seq + 1);
+        if (slot->readers.load() > 0) {
+            slot->seq.store(seq);
+            continue;
+        }
+        uint8_t *dst = (uint8_t *)slot + kFrameRingAlignment;
+        if (image.isContinuous()) {
+            memcpy(dst, image.data, row_size * image.rows);
+        } else {
+            for (int y = 0; y < image.rows; y++) {
+                memcpy(dst + y * row_size, image.ptr(y), row_size);
+            }
+        }
+        slot->rows = image.rows;
+        slot->cols = image.cols;
+        slot->type = image.type();
+        slot->seq.store(seq + 2, std::memory_order_release);
+        *ref = FrameRingRef{header->instance, i, seq + 2};
+        return true;
+    }
+    return false;
+}
+
+FrameRingReader::FrameRingReader(const std::string &name)
+    : data(nullptr), size(0) {
+    int fd = shm_open(ShmName(name).c_str(), O_RDWR, 0);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 ||
+        (size_t)st.st_size < kFrameRingAlignment) {
+        std::cout << "Failed to open frame ring " << name << std::endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    // writable, pins are counted in the slots
+    void *mapping =
+        mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cout << "Failed to map frame ring " << name << std::endl;
+        return;
+    }
+    this->data = (uint8_t *)mapping;
+    this->size = st.st_size;
+    const FrameRingHeader *header = (const FrameRingHeader *)this->data;
+    if (memcmp(header->magic, kFrameRingMagic, sizeof(header->magic)) != 0 ||
+        header->version != 1 ||
+        kFrameRingAlignment + header->num_slots * header->slot_stride >
+            this->size) {
+        std::cout << name << " is not a frame ring" << std::endl;
+        munmap(this->data, this->size);
+        this->data = nullptr;
+    }
+}
+
+FrameRingReader::~FrameRingReader() {
+    if (this->data) {
+        munmap(this->data, this->size);
+    }
+}
+
+uint64_t FrameRingReader::Instance() const {
+    return ((const FrameRingHeader *)this->data)->instance;
+}
+
+shared_ptr<const cv::Mat> FrameRingReader::Read(const FrameRingRef &ref) {
+    const FrameRingHeader *header = (const FrameRingHeader *)this->data;
+    if (ref.instance != header->instance || ref.slot >= header->num_slots ||
+        ref.seq % 2 != 0) {
+        return nullptr;
+    }
+    FrameRingSlot *slot = Slot(this->data, ref.slot);
+    // seq_cst pin then load, against the writer's store then check
+    slot->readers.fetch_add(1);
+    if (slot->seq.load() != ref.seq) {
+        slot->readers.fetch_sub(1);
+        return nullptr;
+    }
+    cv::Mat *image = new cv::Mat(slot->rows, slot->cols, slot->type,
+                                 (uint8_t *)slot + kFrameRingAlignment);
+    return shared_ptr<const cv::Mat>(image, [slot](const cv::Mat *image) {
+        delete image;
+        slot->readers.fetch_sub(1, std::memory_order_release);
+    });
+}
@@ -0,0 +1,101 @@
+// 2026-10-17 22:30
+#ifndef FRAME_RING_H
+#define FRAME_RING_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "common.h"
+
+// a ring of frame slots in POSIX shared memory (/dev/shm/<name>): one
+// process publishes frames, any number of readers in other processes map
+// them without a copy. only a FrameRingRef goes through the broker.
+//
+//   FrameRingHeader                        kFrameRingAlignment bytes
+//   slot 0 .. num_slots - 1                slot_stride bytes each
+//     FrameRingSlot                        kFrameRingAlignment bytes
+//     image, rows packed                   slot_size bytes, padded
+//
+// every slot is a seqlock: its sequence is odd while the writer fills it
+// and advances by 2 per frame, a ref names the slot and the sequence the
+// frame was published with. a reader pins the slot (readers + 1) and then
+// checks the sequence, the writer makes the sequence odd and then checks
+// for pins. either the reader sees the slot being rewritten and gives up,
+// or the writer sees the pin and takes the next slot: a pinned frame is
+// never overwritten and a reader never gets a torn one, only none if it
+// is num_slots frames late. a reader that dies leaks its pins, once every
+// slot is pinned the writes fail.
+
+const char kFrameRingMagic[8] = {'F', 'R', 'M', 'R', 'I', 'N', 'G', '1'};
+const int kFrameRingAlignment = 64;
+
+struct FrameRingHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t num_slots;
+    uint64_t slot_size;
+    uint64_t slot_stride;
+    // creation time in ns, tells the ring from an older one of the name
+    uint64_t instance;
+};
+
+struct FrameRingSlot {
+    std::atomic<uint64_t> seq;
+    std::atomic<int32_t> readers;
+    // cv::Mat geometry of the frame in the slot
+    int32_t rows, cols, type;
+};
+
+static_assert(sizeof(FrameRingHeader) <= kFrameRingAlignment &&
+                  sizeof(FrameRingSlot) <= kFrameRingAlignment,
+              "headers must keep the images aligned");
+static_assert(std::atomic<uint64_t>::is_always_lock_free &&
+                  std::atomic<int32_t>::is_always_lock_free,
+              "slots are shared between processes");
+
+// what the broker carries for a frame
+struct FrameRingRef {
+    uint64_t instance;
+    uint32_t slot;
+    uint64_t seq;
+};
+
+class FrameRingWriter {
+   private:
+    std::string name;
+    uint8_t *data;
+    size_t size;
+    uint32_t next_slot;
+
+   public:
+    // replaces an existing ring of the name, its readers keep their frames
+    FrameRingWriter(const std::string &name, int num_slots,
+                    size_t slot_size);
+    // unlinks the ring
+    ~FrameRingWriter();
+    bool IsOpened() const { return this->data != nullptr; }
+    size_t SlotSize() const;
+    // copies image into the next slot nobody pinned. false if it is larger
+    // than SlotSize() or every slot is pinned
+    bool Write(const cv::Mat &image, FrameRingRef *ref);
+};
+
+class FrameRingReader {
+   private:
+    uint8_t *data;
+    size_t size;
+
+   public:
+    explicit FrameRingReader(const std::string &name);
+    ~FrameRingReader();
+    bool IsOpened() const { return this->data != nullptr; }
+    uint64_t Instance() const;
+    // the frame ref was published with, pinned until the last copy of the
+    // pointer is gone, which must be before the reader. null if it was
+    // overwritten or ref is of another instance of the ring
+    shared_ptr<const cv::Mat> Read(const FrameRingRef &ref);
+};
+
+#endif  // FRAME_RING_H
@@ -0,0 +1,154 @@
+#include "frame_source.h"
+
+#include <algorithm>
+#include <thread>
+
+#include "recording.h"
+#include "trace.h"
+#include "video_capture.h"
+
+FramePacer::FramePacer(double fps)
+    : interval(fps > 0 ? duration_cast<steady_clock::duration>(
+                             duration<double>(1.0 / fps))
+                       : steady_clock::duration::zero()),
+      next(steady_clock::now()) {}
+
+void FramePacer::Wait() {
+    if (this->interval == steady_clock::duration::zero()) {
+        return;
+    }
+    steady_clock::time_point now = steady_clock::now();
+    if (this->next > now) {
+        std::this_thread::sleep_until(this->next);
+        this->next += this->interval;
+    } else {
+        // fell behind, don't try to catch up with a burst of frames
+        this->next = now + this->interval;
+    }
+}
+
+static double VideoFps(const cv::VideoCapture &video, double fps) {
+    if (fps >= 0) {
+        return fps;
+    }
+    double file_fps = video.get(cv::CAP_PROP_FPS);
+    return file_fps > 0 ? file_fps : 30;
+}
+
+VideoFileSource::VideoFileSource(const std::string &path, double fps,
+                                 bool loop)
+    : path(path), video(path), pacer(VideoFps(video, fps)), loop(loop) {}
+
+bool VideoFileSource::IsOpened() const { return this->video.isOpened(); }
+
+cv::Mat VideoFileSource::ReadBGRImage() {
+    TRACE_SCOPE("VideoFileSource::ReadBGRImage");
+    cv::Mat img;
+    if (!this->video.read(img) && this->loop) {
+        this->video.set(cv::CAP_PROP_POS_FRAMES, 0);
+        this->video.read(img);
+    }
+    this->pacer.Wait();
+    return img;
+}
+
+void VideoFileSource::GetShape(int *height, int *width) {
+    *height = this->video.get(cv::CAP_PROP_FRAME_HEIGHT);
+    *width = this->video.get(cv::CAP_PROP_FRAME_WIDTH);
+}
+
+ImageSequenceSource::ImageSequenceSource(const std::string &dir, double fps,
+                                         bool loop)
+    : index(0), pacer(fps), loop(loop) {
+    std::vector<std::string> files;
+    cv::glob(dir + "/*", files);
+    std::sort(files.begin(), files.end());
+    for (const std::string &file : files) {
+        cv::Mat img = cv::imread(file, cv::IMREAD_COLOR);
+        if (!img.empty()) {
+            this->frames.push_back(img);
+        }
+    }
+}
+
+bool ImageSequenceSource::IsOpened() const { return !this->frames.empty(); }
+
+cv::Mat ImageSequenceSource::ReadBGRImage() {
+    if (this->index == this->frames.size() && this->loop) {
+        this->index = 0;
+    }
+    if (this->index == this->frames.size()) {
+        return cv::Mat();
+    }
+    this->pacer.Wait();
+    // the decoded frame itself, the next loop hands it out again
+    return this->frames[this->index++];
+}
+
+void ImageSequenceSource::GetShape(int *height, int *width) {
+    *height = this->frames.empty() ? 0 : this->frames[0].rows;
+    *width = this->frames.empty() ? 0 : this->frames[0].cols;
+}
+
+SyntheticSource::SyntheticSource(int width, int height, double fps)
+    : width(width), height(height), frame_count(0), pacer(fps) {}
+
+cv::Mat SyntheticSource::ReadBGRImage() {
+    TRACE_SCOPE("SyntheticSource::ReadBGRImage");
+    cv::Mat img(this->height, this->width, CV_8UC3);
+    int shift = this->frame_count * 4;
+    int box_size = std::min(this->width, this->height) / 4;
+    int box_x = shift % std::max(1, this->width - box_size);
+    int box_y = (this->height - box_size) / 2;
+    for (int y = 0; y < this->height; y++) {
+        uchar *row = img.ptr(y);
+        bool box_row = y >= box_y && y < box_y + box_size;
+        for (int x = 0; x < this->width; x++) {
+            bool in_box = box_row && x >= box_x && x < box_x + box_size;
+            row[x * 3] = in_box ? 255 : (x + shift) & 0xff;
+            row[x * 3 + 1] = in_box ? 255 : (y + shift) & 0xff;
+            row[x * 3 + 2] = in_box ? 255 : (x + y) & 0xff;
+        }
+    }
+    this->frame_count++;
+    this->pacer.Wait();
+    return img;
+}
+
+void SyntheticSource::GetShape(int *height, int *width) {
+    *height = this->height;
+    *width = this->width;
+}
+
+std::unique_ptr<FrameSource> OpenFrameSource(const std::string &uri,
+                                             double fps, bool loop) {
+    std::unique_ptr<FrameSource> source;
+    struct stat st;
+    if (uri.compare(0, 3, "inu") == 0 &&
+        (uri.size() == 3 || uri[3] == ':')) {
+        bool async = uri.find(":async") != std::string::npos;
+        bool flip = uri.find(":noflip") == std::string::npos;
+        source.reset(new VideoCapture(async, flip));
+    } else if (uri.compare(0, 9, "synthetic") == 0 &&
+               (uri.size() == 9 || uri[9] == ':')) {
+        int width = 1280;
+        int height = 720;
+        if (uri.size() > 10) {
+            sscanf(uri.c_str() + 10, "%dx%d", &width, &height);
+        }
+        source.reset(new SyntheticSource(width, height, std::max(fps, 0.0)));
+    } else if (uri.size() > 5 &&
+               uri.compare(uri.size() - 5, 5, ".rgbd") == 0) {
+        source.reset(new RecordingReader(uri, std::max(fps, 0.0), loop));
+    } else if (stat(uri.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+        source.reset(
+            new ImageSequenceSource(uri, std::max(fps, 0.0), loop));
+    } else {
+        source.reset(new VideoFileSource(uri, fps, loop));
+    }
+    if (!source->IsOpened()) {
+        std::cout << "Failed to open frame source " << uri << std::endl;
+        return nullptr;
+    }
+    return source;
+}
@@ -0,0 +1,110 @@
+// 2026-10-17 15:10
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+// where the pipeline gets its frames from: the Inu sensor (VideoCapture in
+// video_capture.h) or one of the file backed / synthetic sources below, so
+// the native code can run without a device. Frames are BGR 8UC3 like
+// VideoCapture::ReadBGRImage, an empty Mat means the source is exhausted
+// or failed. Frames may be the source's own buffers (a sensor buffer, a
+// decoded image or recording that is handed out again on the next loop),
+// so they are read only: a caller that draws on a frame copies it first.
+class FrameSource {
+   public:
+    virtual ~FrameSource() {}
+    // false if the device / file couldn't be opened
+    virtual bool IsOpened() const = 0;
+    virtual cv::Mat ReadBGRImage() = 0;
+    // 16U depth registered to the BGR image, sources without depth return
+    // an empty Mat
+    virtual cv::Mat ReadDepthImage() { return cv::Mat(); }
+    virtual void GetShape(int *height, int *width) = 0;
+    // capture time in ns (host clock) of the frame last returned by
+    // ReadBGRImage / ReadDepthImage, 0 if the source doesn't know it
+    virtual int64_t BGRTimestamp() const { return 0; }
+    virtual int64_t DepthTimestamp() const { return 0; }
+    // true if the timestamps are of frames captured just now (a sensor),
+    // not replayed from a file
+    virtual bool IsLive() const { return false; }
+    // how the source did so far, a line for the tools to print. empty if
+    // there is nothing to report
+    virtual std::string Report() const { return std::string(); }
+};
+
+// paces Wait() calls to `fps`, fps <= 0 doesn't wait at all (unthrottled,
+// for measuring pipeline throughput instead of the sensor's frame rate)
+class FramePacer {
+   private:
+    steady_clock::duration interval;
+    steady_clock::time_point next;
+
+   public:
+    explicit FramePacer(double fps);
+    void Wait();
+};
+
+class VideoFileSource : public FrameSource {
+   private:
+    std::string path;
+    cv::VideoCapture video;
+    FramePacer pacer;
+    bool loop;
+
+   public:
+    // fps < 0 plays at the file's own frame rate, 0 is unthrottled,
+    // with loop set the file restarts instead of ending
+    explicit VideoFileSource(const std::string &path, double fps = -1,
+                             bool loop = false);
+    bool IsOpened() const override;
+    cv::Mat ReadBGRImage() override;
+    void GetShape(int *height, int *width) override;
+};
+
+// every image of a directory in file name order, decoded on open so that
+// reading a frame never touches the disk
+class ImageSequenceSource : public FrameSource {
+   private:
+    std::vector<cv::Mat> frames;
+    size_t index;
+    FramePacer pacer;
+    bool loop;
+
+   public:
+    explicit ImageSequenceSource(const std::string &dir, double fps = 0,
+                                 bool loop = false);
+    bool IsOpened() const override;
+    cv::Mat ReadBGRImage() override;
+    void GetShape(int *height, int *width) override;
+};
+
+// an endless moving gradient with a bright box sweeping across it
+class SyntheticSource : public FrameSource {
+   private:
+    int width;
+    int height;
+    int64_t frame_count;
+    FramePacer pacer;
+
+   public:
+    SyntheticSource(int width, int height, double fps = 0);
+    bool IsOpened() const override { return true; }
+    cv::Mat ReadBGRImage() override;
+    void GetShape(int *height, int *width) override;
+};
+
+// "inu[:async][:noflip]" for the sensor (see VideoCapture),
+// "synthetic[:WxH]", a .rgbd recording (see recording.h), an image
+// directory or a video file. fps as for VideoFileSource, the Inu sensor
+// always runs at its own rate. returns nullptr if the source can't be
+// opened
+std::unique_ptr<FrameSource> OpenFrameSource(const std::string &uri,
+                                             double fps = -1,
+                                             bool loop = false);
+
+#endif  // FRAME_SOURCE_H
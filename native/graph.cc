@@ -0,0 +1,188 @@
+#include "graph.h"
+
+#include "trace.h"
+
+Graph::Graph() : initialized(false), frame_id(-1) {}
+
+void Graph::AddNode(const std::string &name, Calculator *calculator,
+                    const std::vector<std::string> &inputs,
+                    const std::vector<std::string> &outputs,
+                    bool process_empty) {
+    assert(!this->initialized);
+    Node node;
+    node.name = name;
+    node.calculator.reset(calculator);
+    node.input_names = inputs;
+    node.output_names = outputs;
+    node.process_empty = process_empty;
+    node.stats = CalculatorStats{name, 0, 0, 0};
+    this->nodes.push_back(std::move(node));
+}
+
+void Graph::Observe(const std::string &stream, Observer observer) {
+    assert(!this->initialized);
+    this->pending_observers.emplace_back(stream, observer);
+}
+
+bool Graph::Initialize() {
+    // outputs first: every stream has exactly one producer
+    for (size_t i = 0; i < this->nodes.size(); i++) {
+        Node &node = this->nodes[i];
+        node.calculator->GetContract(&node.contract);
+        if (node.contract.inputs.size() != node.input_names.size() ||
+            node.contract.outputs.size() != node.output_names.size()) {
+            std::cout << "Graph node " << node.name << " expects "
+                      << node.contract.inputs.size() << " inputs and "
+                      << node.contract.outputs.size() << " outputs"
+                      << std::endl;
+            return false;
+        }
+        for (size_t k = 0; k < node.output_names.size(); k++) {
+            const std::string &name = node.output_names[k];
+            if (this->stream_index.count(name)) {
+                std::cout << "Graph stream " << name
+                          << " has more than one producer" << std::endl;
+                return false;
+            }
+            this->stream_index[name] = this->streams.size();
+            node.outputs.push_back(this->streams.size());
+            this->streams.push_back(
+                Stream{name, node.contract.outputs[k], (int)i, Packet(), {}});
+        }
+    }
+    for (Node &node : this->nodes) {
+        for (size_t k = 0; k < node.input_names.size(); k++) {
+            const std::string &name = node.input_names[k];
+            auto stream = this->stream_index.find(name);
+            if (stream == this->stream_index.end()) {
+                std::cout << "Graph stream " << name << " of node "
+                          << node.name << " has no producer" << std::endl;
+                return false;
+            }
+            if (this->streams[stream->second].type !=
+                node.contract.inputs[k]) {
+                std::cout << "Graph stream " << name
+                          << " doesn't carry the packet type node "
+                          << node.name << " expects" << std::endl;
+                return false;
+            }
+            node.inputs.push_back(stream->second);
+        }
+        node.input_packets.resize(node.inputs.size());
+        node.output_packets.resize(node.outputs.size());
+    }
+    for (auto &observer : this->pending_observers) {
+        auto stream = this->stream_index.find(observer.first);
+        if (stream == this->stream_index.end()) {
+            std::cout << "Graph stream " << observer.first
+                      << " doesn't exist" << std::endl;
+            return false;
+        }
+        this->streams[stream->second].observers.push_back(observer.second);
+    }
+    this->pending_observers.clear();
+
+    // Kahn's algorithm, sources keep the order they were added in
+    std::vector<int> num_pending(this->nodes.size());
+    std::vector<int> ready;
+    for (size_t i = 0; i < this->nodes.size(); i++) {
+        num_pending[i] = this->nodes[i].inputs.size();
+        if (num_pending[i] == 0) {
+            ready.push_back(i);
+        }
+    }
+    for (size_t k = 0; k < ready.size(); k++) {
+        this->order.push_back(ready[k]);
+        for (int output : this->nodes[ready[k]].outputs) {
+            for (size_t i = 0; i < this->nodes.size(); i++) {
+                for (int input : this->nodes[i].inputs) {
+                    if (input == output && --num_pending[i] == 0) {
+                        ready.push_back(i);
+                    }
+                }
+            }
+        }
+    }
+    if (this->order.size() != this->nodes.size()) {
+        std::cout << "Graph has a cycle" << std::endl;
+        return false;
+    }
+    this->initialized = true;
+    return true;
+}
+
+bool Graph::RunNode(Node &node) {
+    bool has_empty_input = false;
+    for (size_t k = 0; k < node.inputs.size(); k++) {
+        node.input_packets[k] = this->streams[node.inputs[k]].packet;
+        has_empty_input |= node.input_packets[k].IsEmpty();
+    }
+    for (Packet &packet : node.output_packets) {
+        packet = Packet();
+    }
+    bool ok = true;
+    if (!has_empty_input || node.process_empty) {
+        Calculator &calculator = *node.calculator;
+        calculator.frame_id = this->frame_id;
+        // sources stamp their own packets
+        calculator.timestamp = node.inputs.empty()
+                                   ? 0
+                                   : node.input_packets[0].timestamp;
+        calculator.capture_ns = node.inputs.empty()
+                                    ? 0
+                                    : node.input_packets[0].capture_ns;
+        steady_clock::time_point start = steady_clock::now();
+        ok = calculator.Process(node.input_packets, node.output_packets);
+        double us = duration_cast<nanoseconds>(steady_clock::now() - start)
+                        .count() /
+                    1000.0;
+        node.stats.runs++;
+        node.stats.total_us += us;
+        node.stats.max_us = std::max(node.stats.max_us, us);
+    }
+    for (size_t k = 0; k < node.outputs.size(); k++) {
+        Stream &stream = this->streams[node.outputs[k]];
+        stream.packet = node.output_packets[k];
+        if (stream.packet.IsEmpty()) {
+            continue;
+        }
+        for (Observer &observer : stream.observers) {
+            observer(stream.packet);
+        }
+    }
+    return ok;
+}
+
+bool Graph::Step() {
+    TRACE_SCOPE("Graph::Step");
+    if (!this->initialized) {
+        return false;
+    }
+    this->frame_id++;
+    TRACE_FRAME(this->frame_id);
+    bool ok = true;
+    for (int i : this->order) {
+        ok &= RunNode(this->nodes[i]);
+    }
+    // the frame's packets are only referenced by their consumers now
+    for (Stream &stream : this->streams) {
+        stream.packet = Packet();
+    }
+    for (Node &node : this->nodes) {
+        for (Packet &packet : node.input_packets) {
+            packet = Packet();
+        }
+        for (Packet &packet : node.output_packets) {
+            packet = Packet();
+        }
+    }
+    return ok;
+}
+
+std::vector<CalculatorStats> Graph::Stats() const {
+    std::vector<CalculatorStats> stats;
+    for (int i : this->order) {
+        stats.push_back(this->nodes[i].stats);
+    }
+    return stats;
+}
@@ -0,0 +1,179 @@
+// 2026-10-17 20:30
+#ifndef GRAPH_H
+#define GRAPH_H
+
+#include <cassert>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common.h"
+
+// an in-process calculator graph, so a chain of native stages exchanges
+// frames as shared pointers instead of pickles over the message broker.
+//
+// calculators are connected by named streams. a stream has one producer
+// and any number of consumers (fan-out), and carries typed, immutable
+// packets: consumers share the producer's data, nothing is copied. every
+// Step() runs the graph for one frame: the sources (calculators without
+// inputs) produce the frame's packets, then every other calculator runs
+// once, in dependency order, on the packets its input streams got for
+// that frame. all packets of a step carry the same frame id and capture
+// time.
+//
+// a calculator may leave an output empty (no face, ...). a calculator
+// that has an empty input is skipped and its outputs stay empty, unless it
+// was added with process_empty.
+
+// one address per packet type, the tree is built without RTTI
+template <typename T>
+const void *PacketTypeId() {
+    static const char id = 0;
+    return &id;
+}
+
+class Packet {
+   private:
+    shared_ptr<const void> data;
+    const void *type;
+
+   public:
+    int64_t frame_id;
+    // capture time in ns of the frame the packet was derived from
+    int64_t timestamp;
+    // when the frame was captured (read, for sources without a live clock),
+    // steady_clock ns: unlike timestamp (the sensor's or a recording's
+    // clock) comparable to the monotonic time of other processes, for
+    // latencies
+    int64_t capture_ns;
+
+    Packet() : type(nullptr), frame_id(-1), timestamp(0), capture_ns(0) {}
+    template <typename T>
+    static Packet Make(T value, int64_t frame_id, int64_t timestamp,
+                       int64_t capture_ns) {
+        Packet packet;
+        packet.data = std::make_shared<const T>(std::move(value));
+        packet.type = PacketTypeId<T>();
+        packet.frame_id = frame_id;
+        packet.timestamp = timestamp;
+        packet.capture_ns = capture_ns;
+        return packet;
+    }
+    bool IsEmpty() const { return !this->data; }
+    template <typename T>
+    bool Holds() const {
+        return this->type == PacketTypeId<T>();
+    }
+    // the packet must hold a T
+    template <typename T>
+    const T &Get() const {
+        assert(Holds<T>());
+        return *static_cast<const T *>(this->data.get());
+    }
+    // shares ownership of the data, e.g. to keep it alive outside the graph
+    shared_ptr<const void> Lease() const { return this->data; }
+};
+
+// the packet types of a calculator's input and output streams, in order
+class CalculatorContract {
+   public:
+    std::vector<const void *> inputs;
+    std::vector<const void *> outputs;
+    template <typename T>
+    void Input() {
+        this->inputs.push_back(PacketTypeId<T>());
+    }
+    template <typename T>
+    void Output() {
+        this->outputs.push_back(PacketTypeId<T>());
+    }
+};
+
+class Calculator {
+   public:
+    virtual ~Calculator() {}
+    virtual void GetContract(CalculatorContract *contract) const = 0;
+    // one packet per input stream, all of the current frame. outputs come
+    // in empty and sized to the contract, fill them with Output<T>(). a
+    // source returns false when it is exhausted, Step() then returns false
+    virtual bool Process(const std::vector<Packet> &inputs,
+                         std::vector<Packet> &outputs) = 0;
+
+   protected:
+    int64_t frame_id;
+    int64_t timestamp;
+    int64_t capture_ns;
+    template <typename T>
+    Packet Output(T value) const {
+        return Packet::Make<T>(std::move(value), this->frame_id,
+                               this->timestamp, this->capture_ns);
+    }
+    friend class Graph;
+};
+
+// wall time a calculator spent in Process, in microseconds
+struct CalculatorStats {
+    std::string name;
+    uint64_t runs;
+    double total_us;
+    double max_us;
+};
+
+class Graph {
+   public:
+    typedef std::function<void(const Packet &)> Observer;
+
+   private:
+    struct Stream {
+        std::string name;
+        const void *type;
+        int producer;
+        Packet packet;
+        std::vector<Observer> observers;
+    };
+    struct Node {
+        std::string name;
+        std::unique_ptr<Calculator> calculator;
+        std::vector<std::string> input_names;
+        std::vector<std::string> output_names;
+        bool process_empty;
+        CalculatorContract contract;
+        std::vector<int> inputs;
+        std::vector<int> outputs;
+        std::vector<Packet> input_packets;
+        std::vector<Packet> output_packets;
+        CalculatorStats stats;
+    };
+    std::vector<Node> nodes;
+    std::vector<Stream> streams;
+    std::map<std::string, int> stream_index;
+    // nodes in dependency order, sources first
+    std::vector<int> order;
+    std::vector<std::pair<std::string, Observer>> pending_observers;
+    bool initialized;
+    int64_t frame_id;
+    bool RunNode(Node &node);
+
+   public:
+    Graph();
+    // takes ownership of calculator. input / output stream names match the
+    // calculator's contract in order
+    void AddNode(const std::string &name, Calculator *calculator,
+                 const std::vector<std::string> &inputs,
+                 const std::vector<std::string> &outputs,
+                 bool process_empty = false);
+    // called with every non empty packet of the stream, right after its
+    // producer ran. observers run on the thread calling Step()
+    void Observe(const std::string &stream, Observer observer);
+    // resolves the streams, checks the packet types and orders the nodes.
+    // false (with the reason printed) if the graph is malformed
+    bool Initialize();
+    // runs one frame, false once a source is exhausted
+    bool Step();
+    int64_t FrameId() const { return this->frame_id; }
+    std::vector<CalculatorStats> Stats() const;
+};
+
+#endif  // GRAPH_H
@@ -8,12 +8,20 @@ namespace PyInuStream {
 void read_bgr_image(uint8_t* output, int output_size) {
     // 8UC3
     cv::Mat img = capture.ReadBGRImage();
+    if (img.empty()) {
+        memset(output, 0, output_size);
+        return;
+    }
     memcpy(output, img.data, output_size);
 }
 
 void read_depth_image(uint8_t* output, int output_size) {
     // 16U
     cv::Mat img = capture.ReadDepthImage();
+    if (img.empty()) {
+        memset(output, 0, output_size);
+        return;
+    }
     memcpy(output, img.data, output_size);
 }
 
@@ -0,0 +1,44 @@
+// 2026-10-17 23:59
+#ifndef JSON_H
+#define JSON_H
+
+#include <ostream>
+#include <sstream>
+#include <string>
+
+// s quoted and escaped, with the bytes from 0x7f \u00XX if escape_high
+inline void JsonQuote(std::ostream &out, const std::string &s,
+                      bool escape_high) {
+    out << '"';
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        } else if (c < 0x20 || (escape_high && c >= 0x7f)) {
+            static const char hex[] = "0123456789abcdef";
+            out << "\\u00" << hex[c >> 4] << hex[c & 15];
+        } else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+// s as a JSON string, quoted. UTF-8 is passed through
+inline void JsonString(std::ostream &out, const std::string &s) {
+    JsonQuote(out, s, false);
+}
+
+inline std::string JsonString(const std::string &s) {
+    std::ostringstream out;
+    JsonString(out, s);
+    return out.str();
+}
+
+// the bytes of s as a JSON string of ASCII, one code point per byte: for
+// names that are bytes (the brokers' topics), encoded as latin-1 they are
+// the bytes again
+inline void JsonBytes(std::ostream &out, const std::string &s) {
+    JsonQuote(out, s, true);
+}
+
+#endif  // JSON_H
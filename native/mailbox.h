@@ -0,0 +1,63 @@
+// 2026-10-17 17:20
+#ifndef MAILBOX_H
+#define MAILBOX_H
+
+#include <atomic>
+#include <cstdint>
+
+// single producer / single consumer slot that only keeps the newest value,
+// a lock-free triple buffer: the producer owns the back slot, the consumer
+// the front slot, and the two swap their slot with the shared middle one.
+// Post never waits for the consumer, a value that is replaced before it was
+// taken counts as dropped. Take never waits for the producer.
+template <typename T>
+class LatestMailbox {
+   private:
+    // set in `middle` while it holds a value that wasn't taken yet
+    static const int kFresh = 4;
+    T slots[3];
+    int back;
+    std::atomic<int> middle;
+    int front;
+    std::atomic<uint64_t> num_posted;
+    std::atomic<uint64_t> num_dropped;
+
+   public:
+    LatestMailbox()
+        : back(0), middle(1), front(2), num_posted(0), num_dropped(0) {}
+
+    // producer side
+    void Post(const T &value) {
+        this->slots[this->back] = value;
+        int old = this->middle.exchange(this->back | kFresh,
+                                        std::memory_order_acq_rel);
+        this->back = old & ~kFresh;
+        this->num_posted.fetch_add(1, std::memory_order_relaxed);
+        if (old & kFresh) {
+            this->num_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // consumer side: the newest value posted since the last Take, nullptr
+    // if there is none. the pointee stays valid until the next Take
+    const T *Take() {
+        if (!(this->middle.load(std::memory_order_relaxed) & kFresh)) {
+            return nullptr;
+        }
+        int old = this->middle.exchange(this->front, std::memory_order_acq_rel);
+        this->front = old & ~kFresh;
+        return &this->slots[this->front];
+    }
+
+    bool HasFresh() const {
+        return this->middle.load(std::memory_order_acquire) & kFresh;
+    }
+    uint64_t NumPosted() const {
+        return this->num_posted.load(std::memory_order_relaxed);
+    }
+    uint64_t NumDropped() const {
+        return this->num_dropped.load(std::memory_order_relaxed);
+    }
+};
+
+#endif  // MAILBOX_H
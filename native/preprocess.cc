@@ -0,0 +1,332 @@
+#include "preprocess.h"
+
+#include "simd.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace {
+// uint8 (0,255) -> float32 (-1,1), padding (black) ends up at kBias
+const float kScale = 1.0f / 127.5f;
+const float kBias = -1.0f;
+
+// writes pixels [begin, count) of a row of `count` RGB float pixels
+// interpolated between two source rows
+template <int kChannels, bool kSwap>
+inline void LetterboxPixels(const uchar *row0, const uchar *row1, float wy,
+                            const ResizeTap *taps, int begin, int count,
+                            float *output) {
+    for (int i = begin; i < count; i++) {
+        const ResizeTap &tap = taps[i];
+        const uchar *p00 = row0 + tap.index0 * kChannels;
+        const uchar *p01 = row0 + tap.index1 * kChannels;
+        const uchar *p10 = row1 + tap.index0 * kChannels;
+        const uchar *p11 = row1 + tap.index1 * kChannels;
+        for (int c = 0; c < 3; c++) {
+            float top = p00[c] + (p01[c] - p00[c]) * tap.weight;
+            float bottom = p10[c] + (p11[c] - p10[c]) * tap.weight;
+            float v = top + (bottom - top) * wy;
+            output[i * 3 + (kSwap ? 2 - c : c)] = v * kScale + kBias;
+        }
+    }
+}
+
+template <int kChannels, bool kSwap>
+void LetterboxRow(const uchar *row0, const uchar *row1, float wy,
+                  const ResizeTap *taps, int count, float *output) {
+    LetterboxPixels<kChannels, kSwap>(row0, row1, wy, taps, 0, count,
+                                      output);
+}
+
+// pixels [begin, end) of ConvertToBGR's row, output pixel x is source pixel
+// (kFlip ? width - 1 - x : x)
+template <int kChannels, bool kSwap, bool kFlip>
+inline void ConvertPixels(const uchar *src, int width, int begin, int end,
+                          uchar *output) {
+    for (int x = begin; x < end; x++) {
+        const uchar *p = src + (kFlip ? width - 1 - x : x) * kChannels;
+        uchar *q = output + x * 3;
+        q[0] = p[kSwap ? 2 : 0];
+        q[1] = p[1];
+        q[2] = p[kSwap ? 0 : 2];
+    }
+}
+
+template <int kChannels, bool kSwap, bool kFlip>
+void ConvertRow(const uchar *src, int width, uchar *output) {
+    ConvertPixels<kChannels, kSwap, kFlip>(src, width, 0, width, output);
+}
+
+#if defined(SIMD_X86)
+template <int kChannels>
+SIMD_TARGET("sse4.1")
+inline __m128 LoadPixel(const uchar *p) {
+    uint32_t v;
+    if (kChannels == 4) {
+        memcpy(&v, p, 4);
+    } else {
+        // don't read the 4th byte, it is past the end of the last pixel
+        v = p[0] | p[1] << 8 | p[2] << 16;
+    }
+    return _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(v)));
+}
+
+template <int kChannels, bool kSwap>
+SIMD_TARGET("sse4.1")
+inline __m128 LerpPixel(const uchar *row0, const uchar *row1,
+                        const ResizeTap &tap, __m128 wy) {
+    __m128 wx = _mm_set1_ps(tap.weight);
+    __m128 p00 = LoadPixel<kChannels>(row0 + tap.index0 * kChannels);
+    __m128 p01 = LoadPixel<kChannels>(row0 + tap.index1 * kChannels);
+    __m128 p10 = LoadPixel<kChannels>(row1 + tap.index0 * kChannels);
+    __m128 p11 = LoadPixel<kChannels>(row1 + tap.index1 * kChannels);
+    __m128 top = _mm_add_ps(p00, _mm_mul_ps(_mm_sub_ps(p01, p00), wx));
+    __m128 bottom = _mm_add_ps(p10, _mm_mul_ps(_mm_sub_ps(p11, p10), wx));
+    __m128 v = _mm_add_ps(top, _mm_mul_ps(_mm_sub_ps(bottom, top), wy));
+    v = _mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(kScale)), _mm_set1_ps(kBias));
+    if (kSwap) {
+        v = _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 0, 1, 2));
+    }
+    return v;
+}
+
+// one pixel per iteration from pixel i. the 4th float spills into the next
+// pixel, which is written afterwards, so the last pixel must not be written
+// here: it is left to LetterboxPixels. returns where it stopped
+template <int kChannels, bool kSwap>
+SIMD_TARGET("sse4.1")
+inline int LetterboxPixelsSSE41(const uchar *row0, const uchar *row1,
+                                __m128 wy4, const ResizeTap *taps, int i,
+                                int count, float *output) {
+    for (; i + 1 < count; i++) {
+        _mm_storeu_ps(output + i * 3,
+                      LerpPixel<kChannels, kSwap>(row0, row1, taps[i], wy4));
+    }
+    return i;
+}
+
+template <int kChannels, bool kSwap>
+SIMD_TARGET("sse4.1")
+void LetterboxRowSSE41(const uchar *row0, const uchar *row1, float wy,
+                       const ResizeTap *taps, int count, float *output) {
+    int i = LetterboxPixelsSSE41<kChannels, kSwap>(
+        row0, row1, _mm_set1_ps(wy), taps, 0, count, output);
+    LetterboxPixels<kChannels, kSwap>(row0, row1, wy, taps, i, count,
+                                      output);
+}
+
+template <int kChannels, bool kSwap>
+SIMD_TARGET("avx2")
+void LetterboxRowAVX2(const uchar *row0, const uchar *row1, float wy,
+                      const ResizeTap *taps, int count, float *output) {
+    __m128 wy4 = _mm_set1_ps(wy);
+    // two pixels per iteration, the 6 valid floats are packed to the front
+    // and the 2 trailing floats are overwritten by the next pixel
+    const __m256i pack = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+    int i = 0;
+    for (; i + 2 < count; i += 2) {
+        __m128 a = LerpPixel<kChannels, kSwap>(row0, row1, taps[i], wy4);
+        __m128 b = LerpPixel<kChannels, kSwap>(row0, row1, taps[i + 1], wy4);
+        __m256 v = _mm256_insertf128_ps(_mm256_castps128_ps256(a), b, 1);
+        _mm256_storeu_ps(output + i * 3, _mm256_permutevar8x32_ps(v, pack));
+    }
+    i = LetterboxPixelsSSE41<kChannels, kSwap>(row0, row1, wy4, taps, i,
+                                               count, output);
+    LetterboxPixels<kChannels, kSwap>(row0, row1, wy, taps, i, count,
+                                      output);
+}
+
+template <int kChannels, bool kSwap, bool kFlip>
+SIMD_TARGET("sse4.1")
+void ConvertRowSSE41(const uchar *src, int width, uchar *output) {
+    int x = 0;
+    // 5 (3 channels) or 4 (4 channels) pixels per shuffle, loaded and
+    // stored 16 bytes at a time. the unused store bytes spill into the
+    // next pixels, which are written afterwards
+    const int kPixels = kChannels == 3 ? 5 : 4;
+    alignas(16) char mask[16];
+    for (int i = 0; i < 16; i++) {
+        int j = i / 3;
+        int c = i % 3;
+        int src_pixel = kFlip ? kPixels - 1 - j : j;
+        int src_channel = kSwap ? 2 - c : c;
+        mask[i] = j < kPixels ? src_pixel * kChannels + src_channel : -1;
+    }
+    const __m128i shuffle = _mm_load_si128((const __m128i *)mask);
+    if (kFlip && kChannels == 3 && width > 0) {
+        // the 16 byte load of the first chunk would read a byte past the
+        // end of the row
+        ConvertPixels<kChannels, kSwap, kFlip>(src, width, 0, 1, output);
+        x = 1;
+    }
+    for (; x + kPixels <= width && x * 3 + 16 <= width * 3 &&
+           (kFlip || x * kChannels + 16 <= width * kChannels);
+         x += kPixels) {
+        const uchar *p = src + (kFlip ? width - x - kPixels : x) * kChannels;
+        __m128i v = _mm_loadu_si128((const __m128i *)p);
+        _mm_storeu_si128((__m128i *)(output + x * 3),
+                         _mm_shuffle_epi8(v, shuffle));
+    }
+    ConvertPixels<kChannels, kSwap, kFlip>(src, width, x, width, output);
+}
+#endif
+
+typedef void (*ConvertRowFn)(const uchar *, int, uchar *);
+
+template <int kChannels, bool kSwap, bool kFlip>
+ConvertRowFn SelectConvertRow() {
+#if defined(SIMD_X86)
+    if (SimdLevel() >= kSimdSSE41) {
+        return ConvertRowSSE41<kChannels, kSwap, kFlip>;
+    }
+#endif
+    return ConvertRow<kChannels, kSwap, kFlip>;
+}
+
+template <bool kFlip>
+ConvertRowFn GetConvertRow(PixelFormat format) {
+    switch (format) {
+        case kPixelRGB:
+            return SelectConvertRow<3, true, kFlip>();
+        case kPixelBGR:
+            return SelectConvertRow<3, false, kFlip>();
+        case kPixelRGBA:
+            return SelectConvertRow<4, true, kFlip>();
+        case kPixelBGRA:
+            return SelectConvertRow<4, false, kFlip>();
+    }
+    return nullptr;
+}
+
+typedef void (*LetterboxRowFn)(const uchar *, const uchar *, float,
+                               const ResizeTap *, int, float *);
+
+template <int kChannels, bool kSwap>
+LetterboxRowFn SelectLetterboxRow() {
+#if defined(SIMD_X86)
+    switch (SimdLevel()) {
+        case kSimdAVX2:
+            return LetterboxRowAVX2<kChannels, kSwap>;
+        case kSimdSSE41:
+            return LetterboxRowSSE41<kChannels, kSwap>;
+        case kSimdNone:
+            break;
+    }
+#endif
+    return LetterboxRow<kChannels, kSwap>;
+}
+
+LetterboxRowFn GetLetterboxRow(PixelFormat format) {
+    switch (format) {
+        case kPixelRGB:
+            return SelectLetterboxRow<3, false>();
+        case kPixelBGR:
+            return SelectLetterboxRow<3, true>();
+        case kPixelRGBA:
+            return SelectLetterboxRow<4, false>();
+        case kPixelBGRA:
+            return SelectLetterboxRow<4, true>();
+    }
+    return nullptr;
+}
+
+int GetChannels(PixelFormat format) {
+    return (format == kPixelRGBA || format == kPixelBGRA) ? 4 : 3;
+}
+}  // namespace
+
+Preprocessor::Preprocessor(int roi_width, int roi_height)
+    : roi_width(roi_width),
+      roi_height(roi_height),
+      src_width(0),
+      src_height(0),
+      new_width(0),
+      new_height(0),
+      top(0),
+      left(0) {}
+
+void Preprocessor::UpdateGeometry(int width, int height) {
+    this->src_width = width;
+    this->src_height = height;
+    // same rounding as ResizeAndKeepAspectRatio
+    float orig_aspect_ratio = (float)height / width;
+    float roi_aspect_ratio = (float)this->roi_height / this->roi_width;
+    if (orig_aspect_ratio < roi_aspect_ratio) {
+        this->new_width = this->roi_width;
+        this->new_height = int(this->roi_width * orig_aspect_ratio);
+    } else {
+        this->new_height = this->roi_height;
+        this->new_width = int(this->roi_height / orig_aspect_ratio);
+    }
+    this->top = (this->roi_height - this->new_height) / 2;
+    this->left = (this->roi_width - this->new_width) / 2;
+
+    // bilinear taps with cv::INTER_LINEAR's pixel center convention
+    auto gen_taps = [](int src_size, int dst_size,
+                       std::vector<ResizeTap> &taps) {
+        float scale = (float)src_size / dst_size;
+        taps.resize(dst_size);
+        for (int i = 0; i < dst_size; i++) {
+            float f = (i + 0.5f) * scale - 0.5f;
+            int index = (int)std::floor(f);
+            f -= index;
+            if (index < 0) {
+                index = 0;
+                f = 0;
+            }
+            if (index >= src_size - 1) {
+                index = src_size - 1;
+                f = 0;
+            }
+            taps[i] =
+                ResizeTap{index, std::min(index + 1, src_size - 1), f};
+        }
+    };
+    gen_taps(width, this->new_width, this->x_taps);
+    gen_taps(height, this->new_height, this->y_taps);
+}
+
+LetterboxPadding Preprocessor::Run(const cv::Mat &img, PixelFormat format,
+                                   float *output) {
+    TRACE_SCOPE("Preprocessor::Run");
+    assert(img.depth() == CV_8U && img.channels() == GetChannels(format));
+    if (img.cols != this->src_width || img.rows != this->src_height) {
+        UpdateGeometry(img.cols, img.rows);
+    }
+    LetterboxRowFn letterbox_row = GetLetterboxRow(format);
+
+    int row_size = this->roi_width * 3;
+    int right = this->left + this->new_width;
+    for (int y = 0; y < this->roi_height; y++) {
+        float *out = output + y * row_size;
+        int src_y = y - this->top;
+        if (src_y < 0 || src_y >= this->new_height) {
+            std::fill(out, out + row_size, kBias);
+            continue;
+        }
+        const ResizeTap &tap = this->y_taps[src_y];
+        std::fill(out, out + this->left * 3, kBias);
+        letterbox_row(img.ptr(tap.index0), img.ptr(tap.index1), tap.weight,
+                      this->x_taps.data(), this->new_width,
+                      out + this->left * 3);
+        std::fill(out + right * 3, out + row_size, kBias);
+    }
+    return LetterboxPadding{
+        (float)this->top / this->roi_height,
+        (float)this->left / this->roi_width,
+    };
+}
+
+void ConvertToBGR(const cv::Mat &img, PixelFormat format, bool flip,
+                  cv::Mat &output) {
+    TRACE_SCOPE("ConvertToBGR");
+    assert(img.depth() == CV_8U && img.channels() == GetChannels(format));
+    output.create(img.rows, img.cols, CV_8UC3);
+    ConvertRowFn convert_row =
+        flip ? GetConvertRow<true>(format) : GetConvertRow<false>(format);
+    for (int y = 0; y < img.rows; y++) {
+        convert_row(img.ptr(y), img.cols, output.ptr(y));
+    }
+}
@@ -0,0 +1,61 @@
+// 2026-10-17 09:40
+#ifndef PREPROCESS_H
+#define PREPROCESS_H
+
+#include <vector>
+
+#include "common.h"
+
+// channel order of the source frame, covers every format that
+// VideoCapture::ReadBGRImage can get from the sensor
+enum PixelFormat {
+    kPixelRGB,
+    kPixelBGR,
+    kPixelRGBA,
+    kPixelBGRA,
+};
+
+// single pass replacement of cvtColor(..., BGR) + flip(..., 1): copies a
+// packed 8 bit `format` image into 8UC3 BGR, mirrored horizontally if
+// `flip`. output is only (re)allocated when its size or type is wrong, so
+// passing the same Mat every frame never allocates
+void ConvertToBGR(const cv::Mat &img, PixelFormat format, bool flip,
+                  cv::Mat &output);
+
+// one bilinear sample: two source rows/cols and the weight of the second
+struct ResizeTap {
+    int index0, index1;
+    float weight;
+};
+
+struct LetterboxPadding {
+    float v_padding;
+    float h_padding;
+};
+
+// single pass replacement of cvtColor + ResizeAndKeepAspectRatio +
+// convertTo: bilinear resize keeping the aspect ratio, black borders,
+// RGB channel order and (-1,1) normalization, written straight into a
+// packed HWC float tensor of roi_width x roi_height
+class Preprocessor {
+   private:
+    int roi_width;
+    int roi_height;
+    // geometry is only recomputed when the source size changes
+    int src_width;
+    int src_height;
+    int new_width;
+    int new_height;
+    int top;
+    int left;
+    std::vector<ResizeTap> x_taps;
+    std::vector<ResizeTap> y_taps;
+    void UpdateGeometry(int width, int height);
+
+   public:
+    Preprocessor(int roi_width, int roi_height);
+    LetterboxPadding Run(const cv::Mat &img, PixelFormat format,
+                         float *output);
+};
+
+#endif  // PREPROCESS_H
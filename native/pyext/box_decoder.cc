@@ -0,0 +1,214 @@
+// 2026-10-17 19:55
+// box_decoder: SsdDecoder (ssd_decoder.h) for the Python box detectors,
+// which run their models with onnxruntime / TF and only need the decode
+// and NMS of the raw outputs.
+//
+//   decoder = box_decoder.Decoder("face", max_detections=0, weighted=False)
+//   raw = decoder.decode(regressors, classificators)
+//   boxes = np.frombuffer(raw, dtype)
+//
+// regressors and classificators are any C contiguous float32 buffers of
+// num_boxes * num_coords and num_boxes values. decode returns the boxes
+// surviving NMS, best first, packed like BasicBox: float32 score, xmin,
+// ymin, width, height and num_keypoints (x, y), all normalized to the
+// model input.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <structmember.h>
+
+#include <cstring>
+#include <string>
+
+#include "ssd_decoder.h"
+
+class AnyDecoder {
+   public:
+    virtual ~AnyDecoder() {}
+    // a bytearray of the packed boxes
+    virtual PyObject *Decode(const float *raw_boxes,
+                             const float *raw_scores) = 0;
+};
+
+template <typename Spec>
+class SpecDecoder : public AnyDecoder {
+   private:
+    SsdDecoder<Spec> decoder;
+
+   public:
+    SpecDecoder(int max_detections, NMSMode nms_mode)
+        : decoder(max_detections, nms_mode) {}
+    PyObject *Decode(const float *raw_boxes,
+                     const float *raw_scores) override {
+        typedef typename SsdDecoder<Spec>::Box Box;
+        std::vector<Box> boxes = this->decoder.Decode(raw_boxes, raw_scores);
+        PyObject *output =
+            PyByteArray_FromStringAndSize(nullptr, boxes.size() * sizeof(Box));
+        if (output && !boxes.empty()) {
+            memcpy(PyByteArray_AS_STRING(output), boxes.data(),
+                   boxes.size() * sizeof(Box));
+        }
+        return output;
+    }
+};
+
+struct DecoderObject {
+    PyObject_HEAD
+    AnyDecoder *decoder;
+    int num_boxes;
+    int num_coords;
+    int num_keypoints;
+    int input_width;
+    int input_height;
+    float min_score_thresh;
+    float nms_thresh;
+};
+
+template <typename Spec>
+static void InitDecoder(DecoderObject *self, int max_detections,
+                        NMSMode nms_mode) {
+    self->decoder = new SpecDecoder<Spec>(max_detections, nms_mode);
+    self->num_boxes = SsdDecoder<Spec>::kNumBoxes;
+    self->num_coords = Spec::kNumCoords;
+    self->num_keypoints = Spec::kNumKeyPoints;
+    self->input_width = Spec::kInputWidth;
+    self->input_height = Spec::kInputHeight;
+    self->min_score_thresh = Spec::kMinScoreThresh;
+    self->nms_thresh = Spec::kNMSThresh;
+}
+
+static PyObject *Decoder_new(PyTypeObject *type, PyObject *args,
+                             PyObject *kwargs) {
+    static const char *keywords[] = {"spec", "max_detections", "weighted",
+                                     nullptr};
+    const char *spec;
+    int max_detections = 0;
+    int weighted = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s|ip", (char **)keywords,
+                                     &spec, &max_detections, &weighted)) {
+        return nullptr;
+    }
+    NMSMode nms_mode = weighted ? kNMSWeighted : kNMSHard;
+    DecoderObject *self = (DecoderObject *)type->tp_alloc(type, 0);
+    if (!self) {
+        return nullptr;
+    }
+    if (strcmp(spec, "face") == 0) {
+        InitDecoder<FaceDetectionSpec>(self, max_detections, nms_mode);
+    } else if (strcmp(spec, "palm") == 0) {
+        InitDecoder<PalmDetectionSpec>(self, max_detections, nms_mode);
+    } else {
+        Py_DECREF(self);
+        PyErr_Format(PyExc_ValueError, "unknown detector spec '%s'", spec);
+        return nullptr;
+    }
+    return (PyObject *)self;
+}
+
+static void Decoder_dealloc(DecoderObject *self) {
+    delete self->decoder;
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+// a float32 view of obj with exactly `count` values
+static bool GetFloats(PyObject *obj, Py_ssize_t count, const char *name,
+                      Py_buffer *view) {
+    if (PyObject_GetBuffer(obj, view, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) <
+        0) {
+        return false;
+    }
+    const char *format = view->format ? view->format : "B";
+    if (format[0] == '<' || format[0] == '=' || format[0] == '@') {
+        format++;
+    }
+    if (strcmp(format, "f") != 0 || view->itemsize != sizeof(float) ||
+        view->len != count * (Py_ssize_t)sizeof(float)) {
+        PyErr_Format(PyExc_ValueError,
+                     "%s must be %zd contiguous float32 values", name, count);
+        PyBuffer_Release(view);
+        return false;
+    }
+    return true;
+}
+
+static PyObject *Decoder_decode(DecoderObject *self, PyObject *args) {
+    PyObject *regressors, *classificators;
+    if (!PyArg_ParseTuple(args, "OO", &regressors, &classificators)) {
+        return nullptr;
+    }
+    Py_buffer raw_boxes, raw_scores;
+    if (!GetFloats(regressors, (Py_ssize_t)self->num_boxes * self->num_coords,
+                   "regressors", &raw_boxes)) {
+        return nullptr;
+    }
+    if (!GetFloats(classificators, self->num_boxes, "classificators",
+                   &raw_scores)) {
+        PyBuffer_Release(&raw_boxes);
+        return nullptr;
+    }
+    PyObject *output = self->decoder->Decode((const float *)raw_boxes.buf,
+                                             (const float *)raw_scores.buf);
+    PyBuffer_Release(&raw_boxes);
+    PyBuffer_Release(&raw_scores);
+    return output;
+}
+
+static PyMethodDef Decoder_methods[] = {
+    {"decode", (PyCFunction)Decoder_decode, METH_VARARGS,
+     "decode(regressors, classificators) -> bytearray of packed boxes"},
+    {nullptr},
+};
+
+static PyMemberDef Decoder_members[] = {
+    {(char *)"num_boxes", T_INT, offsetof(DecoderObject, num_boxes),
+     READONLY, nullptr},
+    {(char *)"num_coords", T_INT, offsetof(DecoderObject, num_coords),
+     READONLY, nullptr},
+    {(char *)"num_keypoints", T_INT, offsetof(DecoderObject, num_keypoints),
+     READONLY, nullptr},
+    {(char *)"input_width", T_INT, offsetof(DecoderObject, input_width),
+     READONLY, nullptr},
+    {(char *)"input_height", T_INT, offsetof(DecoderObject, input_height),
+     READONLY, nullptr},
+    {(char *)"min_score_thresh", T_FLOAT,
+     offsetof(DecoderObject, min_score_thresh), READONLY, nullptr},
+    {(char *)"nms_thresh", T_FLOAT, offsetof(DecoderObject, nms_thresh),
+     READONLY, nullptr},
+    {nullptr},
+};
+
+static PyTypeObject DecoderType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static PyModuleDef box_decoder_module = {
+    PyModuleDef_HEAD_INIT,
+    "box_decoder",
+    "SSD box decode and NMS",
+    -1,
+};
+
+PyMODINIT_FUNC PyInit_box_decoder() {
+    DecoderType.tp_name = "box_decoder.Decoder";
+    DecoderType.tp_basicsize = sizeof(DecoderObject);
+    DecoderType.tp_new = Decoder_new;
+    DecoderType.tp_dealloc = (destructor)Decoder_dealloc;
+    DecoderType.tp_methods = Decoder_methods;
+    DecoderType.tp_members = Decoder_members;
+    DecoderType.tp_flags = Py_TPFLAGS_DEFAULT;
+    DecoderType.tp_doc =
+        "Decoder(spec, max_detections=0, weighted=False), spec is 'face' "
+        "or 'palm'";
+
+    if (PyType_Ready(&DecoderType) < 0) {
+        return nullptr;
+    }
+    PyObject *module = PyModule_Create(&box_decoder_module);
+    if (!module) {
+        return nullptr;
+    }
+    Py_INCREF(&DecoderType);
+    if (PyModule_AddObject(module, "Decoder", (PyObject *)&DecoderType) < 0) {
+        Py_DECREF(&DecoderType);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
@@ -0,0 +1,119 @@
+// 2026-10-17 20:50
+#ifndef PYEXT_FRAME_BUFFER_H
+#define PYEXT_FRAME_BUFFER_H
+
+// FrameBuffer: a read only cv::Mat for Python through the buffer protocol,
+// np.asarray(buffer) views the Mat without copying. a FrameBuffer holds a
+// lease on whatever owns the pixels (an RGBDFrame, a graph packet) and a
+// reference to the Python object that produced it, numpy keeps the
+// FrameBuffer alive as the base of its views. np.array(buffer) makes a
+// writable copy.
+//
+// header only, every extension is a single translation unit and gets its
+// own type: call InitFrameBufferType from the module init.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <memory>
+
+#include "common.h"
+
+struct FrameBufferObject {
+    PyObject_HEAD
+    // constructed / destroyed in place, PyObjects are C structs
+    shared_ptr<const void> lease;
+    cv::Mat mat;
+    PyObject *owner;
+    const char *format;
+    int ndim;
+    Py_ssize_t shape[3];
+    Py_ssize_t strides[3];
+};
+
+static void FrameBuffer_dealloc(FrameBufferObject *self) {
+    self->mat.~Mat();
+    self->lease.~shared_ptr<const void>();
+    Py_XDECREF(self->owner);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int FrameBuffer_getbuffer(FrameBufferObject *self, Py_buffer *view,
+                                 int flags) {
+    if (flags & PyBUF_WRITABLE) {
+        PyErr_SetString(PyExc_BufferError, "frame buffers are read only");
+        view->obj = nullptr;
+        return -1;
+    }
+    const cv::Mat &mat = self->mat;
+    view->obj = (PyObject *)self;
+    Py_INCREF(self);
+    view->buf = mat.data;
+    view->len = mat.total() * mat.elemSize();
+    view->readonly = 1;
+    view->itemsize = mat.elemSize1();
+    view->format = (flags & PyBUF_FORMAT) ? (char *)self->format : nullptr;
+    view->ndim = self->ndim;
+    view->shape = self->shape;
+    view->strides = self->strides;
+    view->suboffsets = nullptr;
+    view->internal = nullptr;
+    return 0;
+}
+
+static PyBufferProcs FrameBuffer_as_buffer = {
+    (getbufferproc)FrameBuffer_getbuffer,
+    nullptr,
+};
+
+static PyObject *FrameBuffer_shape(FrameBufferObject *self, void *) {
+    return self->ndim == 3 ? Py_BuildValue("(nnn)", self->shape[0],
+                                           self->shape[1], self->shape[2])
+                           : Py_BuildValue("(nn)", self->shape[0],
+                                           self->shape[1]);
+}
+
+static PyGetSetDef FrameBuffer_getset[] = {
+    {"shape", (getter)FrameBuffer_shape, nullptr, "(h, w[, channels])",
+     nullptr},
+    {nullptr},
+};
+
+static PyTypeObject FrameBufferType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static int InitFrameBufferType(const char *name) {
+    FrameBufferType.tp_name = name;
+    FrameBufferType.tp_basicsize = sizeof(FrameBufferObject);
+    FrameBufferType.tp_dealloc = (destructor)FrameBuffer_dealloc;
+    FrameBufferType.tp_as_buffer = &FrameBuffer_as_buffer;
+    FrameBufferType.tp_getset = FrameBuffer_getset;
+    FrameBufferType.tp_flags = Py_TPFLAGS_DEFAULT;
+    FrameBufferType.tp_doc = "read only view of a captured image";
+    return PyType_Ready(&FrameBufferType);
+}
+
+// a view of mat (8U or 16U, 1 to 4 channels, rows may be padded), valid as
+// long as lease is held. owner may be null
+static PyObject *NewFrameBuffer(PyObject *owner,
+                                const shared_ptr<const void> &lease,
+                                const cv::Mat &mat) {
+    FrameBufferObject *self =
+        PyObject_New(FrameBufferObject, &FrameBufferType);
+    if (!self) {
+        return nullptr;
+    }
+    new (&self->lease) shared_ptr<const void>(lease);
+    new (&self->mat) cv::Mat(mat);
+    Py_XINCREF(owner);
+    self->owner = owner;
+    self->format = mat.depth() == CV_16U ? "H" : "B";
+    self->ndim = mat.channels() > 1 ? 3 : 2;
+    self->shape[0] = mat.rows;
+    self->shape[1] = mat.cols;
+    self->shape[2] = mat.channels();
+    self->strides[0] = mat.step[0];
+    self->strides[1] = mat.elemSize();
+    self->strides[2] = mat.elemSize1();
+    return (PyObject *)self;
+}
+
+#endif  // PYEXT_FRAME_BUFFER_H
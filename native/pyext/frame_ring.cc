@@ -0,0 +1,240 @@
+// 2026-10-17 22:55
+// frame_ring: the shared memory frame ring (frame_ring.h) for Python.
+//
+//   writer = frame_ring.Writer("inu_image", image.nbytes, num_slots=8)
+//   ref = writer.write(image)    # (instance, slot, seq), None if it failed
+//
+//   reader = frame_ring.Reader("inu_image")
+//   if ref[0] == reader.instance:
+//       frame = reader.read(*ref[1:])    # FrameBuffer, None if overwritten
+//       image = np.asarray(frame)        # read only view into the ring
+//
+// write() takes uint8 or uint16 arrays of 1 to 4 channels whose rows may
+// be padded, and copies them without the GIL. the FrameBuffers
+// (frame_buffer.h) pin their slot until the last view is gone.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <cstring>
+
+#include "frame_buffer.h"
+#include "frame_ring.h"
+
+struct WriterObject {
+    PyObject_HEAD
+    FrameRingWriter *ring;
+};
+
+struct ReaderObject {
+    PyObject_HEAD
+    FrameRingReader *ring;
+};
+
+static PyObject *Writer_new(PyTypeObject *type, PyObject *args,
+                            PyObject *kwargs) {
+    static const char *keywords[] = {"name", "slot_size", "num_slots",
+                                     nullptr};
+    const char *name;
+    Py_ssize_t slot_size;
+    int num_slots = 8;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "sn|i", (char **)keywords,
+                                     &name, &slot_size, &num_slots)) {
+        return nullptr;
+    }
+    if (num_slots < 1 || slot_size < 1) {
+        PyErr_SetString(PyExc_ValueError,
+                        "num_slots and slot_size must be positive");
+        return nullptr;
+    }
+    WriterObject *self = (WriterObject *)type->tp_alloc(type, 0);
+    if (!self) {
+        return nullptr;
+    }
+    self->ring = new FrameRingWriter(name, num_slots, slot_size);
+    if (!self->ring->IsOpened()) {
+        Py_DECREF(self);
+        PyErr_Format(PyExc_OSError, "Failed to create frame ring %s", name);
+        return nullptr;
+    }
+    return (PyObject *)self;
+}
+
+static void Writer_dealloc(WriterObject *self) {
+    delete self->ring;
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+// a Mat header over view, false with ValueError set if it has no Mat
+// layout
+static bool ViewToMat(const Py_buffer &view, cv::Mat *mat) {
+    const char *format = view.format ? view.format : "B";
+    if (format[0] == '<' || format[0] == '=' || format[0] == '@') {
+        format++;
+    }
+    int depth = strcmp(format, "B") == 0   ? CV_8U
+                : strcmp(format, "H") == 0 ? CV_16U
+                                           : -1;
+    int channels = view.ndim == 3 ? view.shape[2] : 1;
+    if (depth < 0 || view.ndim < 2 || view.ndim > 3 || channels > 4 ||
+        view.strides[1] != view.itemsize * channels ||
+        (view.ndim == 3 && view.strides[2] != view.itemsize) ||
+        view.strides[0] < view.strides[1] * view.shape[1]) {
+        PyErr_SetString(PyExc_ValueError,
+                        "image must be (h, w[, channels]) uint8 or uint16 "
+                        "with packed pixels");
+        return false;
+    }
+    *mat = cv::Mat(view.shape[0], view.shape[1],
+                   CV_MAKETYPE(depth, channels), view.buf, view.strides[0]);
+    return true;
+}
+
+static PyObject *Writer_write(WriterObject *self, PyObject *args) {
+    PyObject *image;
+    if (!PyArg_ParseTuple(args, "O", &image)) {
+        return nullptr;
+    }
+    Py_buffer view;
+    if (PyObject_GetBuffer(image, &view, PyBUF_RECORDS_RO) < 0) {
+        return nullptr;
+    }
+    cv::Mat mat;
+    if (!ViewToMat(view, &mat)) {
+        PyBuffer_Release(&view);
+        return nullptr;
+    }
+    FrameRingRef ref;
+    bool written;
+    Py_BEGIN_ALLOW_THREADS
+    written = self->ring->Write(mat, &ref);
+    Py_END_ALLOW_THREADS
+    PyBuffer_Release(&view);
+    if (!written) {
+        Py_RETURN_NONE;
+    }
+    return Py_BuildValue("(KIK)", (unsigned long long)ref.instance, ref.slot,
+                         (unsigned long long)ref.seq);
+}
+
+static PyObject *Writer_slot_size(WriterObject *self, void *) {
+    return PyLong_FromSize_t(self->ring->SlotSize());
+}
+
+static PyMethodDef Writer_methods[] = {
+    {"write", (PyCFunction)Writer_write, METH_VARARGS,
+     "write(image) -> (instance, slot, seq), None if too large or every "
+     "slot is pinned"},
+    {nullptr},
+};
+
+static PyGetSetDef Writer_getset[] = {
+    {"slot_size", (getter)Writer_slot_size, nullptr, "bytes per frame",
+     nullptr},
+    {nullptr},
+};
+
+static PyObject *Reader_new(PyTypeObject *type, PyObject *args,
+                            PyObject *kwargs) {
+    static const char *keywords[] = {"name", nullptr};
+    const char *name;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "s", (char **)keywords,
+                                     &name)) {
+        return nullptr;
+    }
+    ReaderObject *self = (ReaderObject *)type->tp_alloc(type, 0);
+    if (!self) {
+        return nullptr;
+    }
+    self->ring = new FrameRingReader(name);
+    if (!self->ring->IsOpened()) {
+        Py_DECREF(self);
+        PyErr_Format(PyExc_OSError, "Failed to open frame ring %s", name);
+        return nullptr;
+    }
+    return (PyObject *)self;
+}
+
+static void Reader_dealloc(ReaderObject *self) {
+    // no FrameBuffer is left, they reference the reader
+    delete self->ring;
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *Reader_read(ReaderObject *self, PyObject *args) {
+    unsigned int slot;
+    unsigned long long seq;
+    if (!PyArg_ParseTuple(args, "IK", &slot, &seq)) {
+        return nullptr;
+    }
+    FrameRingRef ref{self->ring->Instance(), slot, seq};
+    shared_ptr<const cv::Mat> image = self->ring->Read(ref);
+    if (!image) {
+        Py_RETURN_NONE;
+    }
+    return NewFrameBuffer((PyObject *)self, image, *image);
+}
+
+static PyObject *Reader_instance(ReaderObject *self, void *) {
+    return PyLong_FromUnsignedLongLong(self->ring->Instance());
+}
+
+static PyMethodDef Reader_methods[] = {
+    {"read", (PyCFunction)Reader_read, METH_VARARGS,
+     "read(slot, seq) -> FrameBuffer, None if the frame was overwritten"},
+    {nullptr},
+};
+
+static PyGetSetDef Reader_getset[] = {
+    {"instance", (getter)Reader_instance, nullptr,
+     "refs of another instance are of an older or newer ring", nullptr},
+    {nullptr},
+};
+
+static PyTypeObject WriterType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+static PyTypeObject ReaderType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static PyModuleDef frame_ring_module = {
+    PyModuleDef_HEAD_INIT,
+    "frame_ring",
+    "shared memory frame ring",
+    -1,
+};
+
+PyMODINIT_FUNC PyInit_frame_ring() {
+    WriterType.tp_name = "frame_ring.Writer";
+    WriterType.tp_basicsize = sizeof(WriterObject);
+    WriterType.tp_new = Writer_new;
+    WriterType.tp_dealloc = (destructor)Writer_dealloc;
+    WriterType.tp_methods = Writer_methods;
+    WriterType.tp_getset = Writer_getset;
+    WriterType.tp_flags = Py_TPFLAGS_DEFAULT;
+    WriterType.tp_doc = "Writer(name, slot_size, num_slots=8)";
+
+    ReaderType.tp_name = "frame_ring.Reader";
+    ReaderType.tp_basicsize = sizeof(ReaderObject);
+    ReaderType.tp_new = Reader_new;
+    ReaderType.tp_dealloc = (destructor)Reader_dealloc;
+    ReaderType.tp_methods = Reader_methods;
+    ReaderType.tp_getset = Reader_getset;
+    ReaderType.tp_flags = Py_TPFLAGS_DEFAULT;
+    ReaderType.tp_doc = "Reader(name)";
+
+    if (InitFrameBufferType("frame_ring.FrameBuffer") < 0 ||
+        PyType_Ready(&WriterType) < 0 || PyType_Ready(&ReaderType) < 0) {
+        return nullptr;
+    }
+    PyObject *module = PyModule_Create(&frame_ring_module);
+    if (!module) {
+        return nullptr;
+    }
+    Py_INCREF(&WriterType);
+    Py_INCREF(&ReaderType);
+    if (PyModule_AddObject(module, "Writer", (PyObject *)&WriterType) < 0 ||
+        PyModule_AddObject(module, "Reader", (PyObject *)&ReaderType) < 0) {
+        Py_DECREF(&WriterType);
+        Py_DECREF(&ReaderType);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
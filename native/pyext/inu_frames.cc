@@ -0,0 +1,159 @@
+// 2026-10-17 19:05
+// inu_frames: the sensor's frames for Python without copying them.
+//
+//   capture = inu_frames.Capture(async_=True, flip=True, rgb=True)
+//   image, depth, timestamp, depth_timestamp = capture.read()
+//   rgb = np.asarray(image)      # (h, w, 3) uint8 view, no copy
+//   depth = np.asarray(depth)    # (h, w) uint16 view, depth may be None
+//
+// read() hands out the RGBDFrame of VideoCapture::ReadRGBDFrame wrapped in
+// FrameBuffers (frame_buffer.h). every FrameBuffer holds a reference to the
+// RGBDFrame (the lease) and to its Capture, so the native buffers and the
+// sensor they come from live until the last view is gone. VideoCapture
+// never reuses a frame that is still referenced. read() releases the GIL
+// while it waits for the sensor.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <mutex>
+
+#include "frame_buffer.h"
+#include "video_capture.h"
+
+struct CaptureObject {
+    PyObject_HEAD
+    VideoCapture *capture;
+    // read() runs without the GIL, two Python threads reading the same
+    // capture are serialized here instead
+    std::mutex *read_mutex;
+};
+
+static PyObject *Capture_new(PyTypeObject *type, PyObject *args,
+                             PyObject *kwargs) {
+    static const char *keywords[] = {"async_", "flip", "rgb", nullptr};
+    int async = 0;
+    int flip = 1;
+    int rgb = 1;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|ppp", (char **)keywords,
+                                     &async, &flip, &rgb)) {
+        return nullptr;
+    }
+    CaptureObject *self = (CaptureObject *)type->tp_alloc(type, 0);
+    if (!self) {
+        return nullptr;
+    }
+    VideoCapture *capture;
+    // the sensor init takes seconds
+    Py_BEGIN_ALLOW_THREADS
+    capture = new VideoCapture(async, flip, rgb);
+    Py_END_ALLOW_THREADS
+    self->capture = capture;
+    self->read_mutex = new std::mutex();
+    if (!capture->IsOpened()) {
+        Py_DECREF(self);
+        PyErr_SetString(PyExc_RuntimeError, "No Inu device available");
+        return nullptr;
+    }
+    return (PyObject *)self;
+}
+
+static void Capture_dealloc(CaptureObject *self) {
+    // no FrameBuffer is left, they reference the capture
+    Py_BEGIN_ALLOW_THREADS
+    delete self->capture;
+    Py_END_ALLOW_THREADS
+    delete self->read_mutex;
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *Capture_read(CaptureObject *self, PyObject *) {
+    shared_ptr<const RGBDFrame> frame;
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> lock(*self->read_mutex);
+        frame = self->capture->ReadRGBDFrame();
+    }
+    Py_END_ALLOW_THREADS
+    if (!frame || frame->bgr.empty()) {
+        Py_RETURN_NONE;
+    }
+    PyObject *image = NewFrameBuffer((PyObject *)self, frame, frame->bgr);
+    if (!image) {
+        return nullptr;
+    }
+    PyObject *depth = Py_None;
+    Py_INCREF(depth);
+    if (!frame->depth.empty()) {
+        Py_DECREF(depth);
+        depth = NewFrameBuffer((PyObject *)self, frame, frame->depth);
+        if (!depth) {
+            Py_DECREF(image);
+            return nullptr;
+        }
+    }
+    return Py_BuildValue("(NNLL)", image, depth,
+                         (long long)frame->bgr_timestamp,
+                         (long long)frame->depth_timestamp);
+}
+
+static PyObject *Capture_shape(CaptureObject *self, PyObject *) {
+    int height, width;
+    self->capture->GetShape(&height, &width);
+    return Py_BuildValue("(ii)", height, width);
+}
+
+static PyObject *Capture_stats(CaptureObject *self, PyObject *) {
+    CaptureStats stats = self->capture->Stats();
+    return Py_BuildValue(
+        "{sKsKsKsdsd}", "posted", (unsigned long long)stats.posted,
+        "dropped", (unsigned long long)stats.dropped, "read",
+        (unsigned long long)stats.read, "mean_latency_ms",
+        stats.mean_latency_ms, "max_latency_ms", stats.max_latency_ms);
+}
+
+static PyMethodDef Capture_methods[] = {
+    {"read", (PyCFunction)Capture_read, METH_NOARGS,
+     "read() -> (image, depth, timestamp_ns, depth_timestamp_ns) or None\n"
+     "the next frame, depth is None if no depth frame matched it"},
+    {"shape", (PyCFunction)Capture_shape, METH_NOARGS,
+     "shape() -> (height, width)"},
+    {"stats", (PyCFunction)Capture_stats, METH_NOARGS,
+     "stats() -> dict, async capture counters"},
+    {nullptr},
+};
+
+static PyTypeObject CaptureType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static PyModuleDef inu_frames_module = {
+    PyModuleDef_HEAD_INIT,
+    "inu_frames",
+    "zero copy Inu sensor frames",
+    -1,
+};
+
+PyMODINIT_FUNC PyInit_inu_frames() {
+    CaptureType.tp_name = "inu_frames.Capture";
+    CaptureType.tp_basicsize = sizeof(CaptureObject);
+    CaptureType.tp_new = Capture_new;
+    CaptureType.tp_dealloc = (destructor)Capture_dealloc;
+    CaptureType.tp_methods = Capture_methods;
+    CaptureType.tp_flags = Py_TPFLAGS_DEFAULT;
+    CaptureType.tp_doc =
+        "Capture(async_=False, flip=True, rgb=True), see VideoCapture";
+
+    if (InitFrameBufferType("inu_frames.FrameBuffer") < 0 ||
+        PyType_Ready(&CaptureType) < 0) {
+        return nullptr;
+    }
+    PyObject *module = PyModule_Create(&inu_frames_module);
+    if (!module) {
+        return nullptr;
+    }
+    Py_INCREF(&CaptureType);
+    if (PyModule_AddObject(module, "Capture", (PyObject *)&CaptureType) < 0) {
+        Py_DECREF(&CaptureType);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
@@ -0,0 +1,259 @@
+// 2026-10-17 21:40
+// inu_graph: the native face path (BuildFaceGraph, calculators.h) run from
+// Python, handing its results to a callback under the topic names of the
+// Python apps it replaces.
+//
+//   pipeline = inu_graph.FacePipeline("inu:async", model, callback)
+//   pipeline.run()     # until the source ends, stop() or callback raises
+//
+// callback(topic, payload, frame_id, capture_ns) runs on the thread calling
+// run() / step(), capture_ns is the frame's monotonic capture time
+// (Packet::capture_ns):
+//
+//   b"image"           FrameBuffer, RGB
+//   b"face_reset"      None, no face in the frame
+//   b"face_box"        bytes, a Box Message of topics.fbs
+//   b"face_roi"        bytes, a RoiImage Message of topics.fbs
+//   b"face_roi_small"  FrameBuffer
+//
+// the FrameBuffers (frame_buffer.h) lease the graph packets, so the frames
+// are handed over without a copy and stay valid while Python holds them.
+// the Messages (topic_codec.h) are encoded before the GIL is taken and
+// published as they are. the GIL is only held while the callback runs.
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <atomic>
+#include <new>
+
+#include "calculators.h"
+#include "frame_buffer.h"
+#include "topic_codec.h"
+
+struct FacePipelineObject {
+    PyObject_HEAD
+    Graph *graph;
+    // observers run on the thread calling Step(), one at a time
+    TopicWriter *writer;
+    PyObject *callback;
+    // set by stop() (any thread) and by a raising callback, checked between
+    // frames while the GIL is released
+    std::atomic<bool> stopped;
+    bool failed;
+};
+
+// calls the callback for the frame of packet, the GIL is held. takes the
+// reference to payload, a null payload is a failed conversion with the
+// exception set
+static void Publish(FacePipelineObject *self, const char *topic,
+                    PyObject *payload, const Packet &packet) {
+    if (!payload) {
+        self->failed = true;
+    } else if (!self->failed) {
+        PyObject *result = PyObject_CallFunction(
+            self->callback, "yOLL", topic, payload,
+            (long long)packet.frame_id, (long long)packet.capture_ns);
+        if (!result) {
+            self->failed = true;
+        }
+        Py_XDECREF(result);
+    }
+    Py_XDECREF(payload);
+    if (self->failed) {
+        self->stopped.store(true, std::memory_order_release);
+    }
+}
+
+// the last Message of the writer
+static PyObject *MessageBytes(const TopicWriter &writer) {
+    return PyBytes_FromStringAndSize((const char *)writer.Data(),
+                                     writer.Size());
+}
+
+static void ObserveFaceGraph(FacePipelineObject *self) {
+    Graph *graph = self->graph;
+    PyObject *owner = (PyObject *)self;
+    graph->Observe("image", [self, owner](const Packet &packet) {
+        PyGILState_STATE state = PyGILState_Ensure();
+        Publish(self, "image",
+                NewFrameBuffer(owner, packet.Lease(),
+                               packet.Get<ColorImage>().image),
+                packet);
+        PyGILState_Release(state);
+    });
+    graph->Observe("face_detections", [self](const Packet &packet) {
+        if (!packet.Get<FaceDetections>().empty()) {
+            return;
+        }
+        PyGILState_STATE state = PyGILState_Ensure();
+        Py_INCREF(Py_None);
+        Publish(self, "face_reset", Py_None, packet);
+        PyGILState_Release(state);
+    });
+    graph->Observe("face_box", [self](const Packet &packet) {
+        self->writer->WriteBox(packet.Get<FaceBox>());
+        PyGILState_STATE state = PyGILState_Ensure();
+        Publish(self, "face_box", MessageBytes(*self->writer), packet);
+        PyGILState_Release(state);
+    });
+    graph->Observe("face_roi", [self](const Packet &packet) {
+        self->writer->WriteRoiImage(packet.Get<RoiImage>());
+        PyGILState_STATE state = PyGILState_Ensure();
+        Publish(self, "face_roi", MessageBytes(*self->writer), packet);
+        PyGILState_Release(state);
+    });
+    graph->Observe("face_roi_small", [self, owner](const Packet &packet) {
+        PyGILState_STATE state = PyGILState_Ensure();
+        Publish(self, "face_roi_small",
+                NewFrameBuffer(owner, packet.Lease(), packet.Get<cv::Mat>()),
+                packet);
+        PyGILState_Release(state);
+    });
+}
+
+static PyObject *FacePipeline_new(PyTypeObject *type, PyObject *args,
+                                  PyObject *kwargs) {
+    static const char *keywords[] = {"source", "model", "callback",
+                                     nullptr};
+    const char *source;
+    const char *model;
+    PyObject *callback;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "ssO", (char **)keywords,
+                                     &source, &model, &callback)) {
+        return nullptr;
+    }
+    if (!PyCallable_Check(callback)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable");
+        return nullptr;
+    }
+    FacePipelineObject *self = (FacePipelineObject *)type->tp_alloc(type, 0);
+    if (!self) {
+        return nullptr;
+    }
+    // tp_alloc only zeroed it
+    new (&self->stopped) std::atomic<bool>(false);
+    Py_INCREF(callback);
+    self->callback = callback;
+    self->graph = new Graph();
+    self->writer = new TopicWriter();
+    ObserveFaceGraph(self);
+    bool ok;
+    // opening the sensor and loading the model take a while
+    Py_BEGIN_ALLOW_THREADS
+    ok = BuildFaceGraph(self->graph, source, model, kPixelRGB);
+    Py_END_ALLOW_THREADS
+    if (!ok) {
+        Py_DECREF(self);
+        PyErr_Format(PyExc_RuntimeError, "Failed to build the face graph "
+                                         "for %s", source);
+        return nullptr;
+    }
+    return (PyObject *)self;
+}
+
+static void FacePipeline_dealloc(FacePipelineObject *self) {
+    // no FrameBuffer is left, they reference the pipeline
+    Py_BEGIN_ALLOW_THREADS
+    delete self->graph;
+    Py_END_ALLOW_THREADS
+    delete self->writer;
+    Py_XDECREF(self->callback);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+// runs frames until the source ends or the pipeline is stopped, at most
+// max_frames if > 0
+static PyObject *RunFrames(FacePipelineObject *self, int64_t max_frames) {
+    self->stopped.store(false, std::memory_order_release);
+    self->failed = false;
+    bool running = true;
+    int64_t frames = 0;
+    Py_BEGIN_ALLOW_THREADS
+    while (running && !self->stopped.load(std::memory_order_acquire) &&
+           (max_frames <= 0 || frames < max_frames)) {
+        running = self->graph->Step();
+        frames++;
+    }
+    Py_END_ALLOW_THREADS
+    if (self->failed) {
+        // the callback's exception is still set
+        return nullptr;
+    }
+    return PyBool_FromLong(running);
+}
+
+static PyObject *FacePipeline_run(FacePipelineObject *self, PyObject *) {
+    return RunFrames(self, 0);
+}
+
+static PyObject *FacePipeline_step(FacePipelineObject *self, PyObject *) {
+    return RunFrames(self, 1);
+}
+
+static PyObject *FacePipeline_stop(FacePipelineObject *self, PyObject *) {
+    self->stopped.store(true, std::memory_order_release);
+    Py_RETURN_NONE;
+}
+
+static PyObject *FacePipeline_stats(FacePipelineObject *self, PyObject *) {
+    std::vector<CalculatorStats> stats = self->graph->Stats();
+    PyObject *list = PyList_New(stats.size());
+    for (size_t i = 0; list && i < stats.size(); i++) {
+        const CalculatorStats &node = stats[i];
+        PyList_SET_ITEM(
+            list, i,
+            Py_BuildValue("(sKdd)", node.name.c_str(),
+                          (unsigned long long)node.runs,
+                          node.runs ? node.total_us / node.runs : 0.0,
+                          node.max_us));
+    }
+    return list;
+}
+
+static PyMethodDef FacePipeline_methods[] = {
+    {"run", (PyCFunction)FacePipeline_run, METH_NOARGS,
+     "run() -> False once the source ended, True if stopped"},
+    {"step", (PyCFunction)FacePipeline_step, METH_NOARGS,
+     "step() -> one frame, False once the source ended"},
+    {"stop", (PyCFunction)FacePipeline_stop, METH_NOARGS,
+     "stop() makes run() return after the current frame"},
+    {"stats", (PyCFunction)FacePipeline_stats, METH_NOARGS,
+     "stats() -> [(node, runs, mean_us, max_us)]"},
+    {nullptr},
+};
+
+static PyTypeObject FacePipelineType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+static PyModuleDef inu_graph_module = {
+    PyModuleDef_HEAD_INIT,
+    "inu_graph",
+    "the native face pipeline",
+    -1,
+};
+
+PyMODINIT_FUNC PyInit_inu_graph() {
+    FacePipelineType.tp_name = "inu_graph.FacePipeline";
+    FacePipelineType.tp_basicsize = sizeof(FacePipelineObject);
+    FacePipelineType.tp_new = FacePipeline_new;
+    FacePipelineType.tp_dealloc = (destructor)FacePipeline_dealloc;
+    FacePipelineType.tp_methods = FacePipeline_methods;
+    FacePipelineType.tp_flags = Py_TPFLAGS_DEFAULT;
+    FacePipelineType.tp_doc = "FacePipeline(source, model, callback)";
+
+    if (InitFrameBufferType("inu_graph.FrameBuffer") < 0 ||
+        PyType_Ready(&FacePipelineType) < 0) {
+        return nullptr;
+    }
+    PyObject *module = PyModule_Create(&inu_graph_module);
+    if (!module) {
+        return nullptr;
+    }
+    Py_INCREF(&FacePipelineType);
+    if (PyModule_AddObject(module, "FacePipeline",
+                           (PyObject *)&FacePipelineType) < 0) {
+        Py_DECREF(&FacePipelineType);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
@@ -0,0 +1,274 @@
+#include "recording.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+
+#include <cstring>
+
+static size_t AlignUp(size_t size) {
+    return (size + kRecordingAlignment - 1) / kRecordingAlignment *
+           kRecordingAlignment;
+}
+
+static size_t ImageBytes(int width, int height, int type) {
+    if (type < 0) {
+        return 0;
+    }
+    return (size_t)width * height * CV_ELEM_SIZE(type);
+}
+
+// images up to this many pixels a side, so their sizes can't overflow
+const int kMaxImageSide = 1 << 16;
+
+static bool CheckImage(int width, int height, int type) {
+    return width > 0 && width <= kMaxImageSide && height > 0 &&
+           height <= kMaxImageSide && type >= 0 &&
+           (type & ~CV_MAT_TYPE_MASK) == 0;
+}
+
+// the geometry, frame layout and index of a recording of size bytes fit
+// together, so no frame or index entry reaches past the end
+static bool CheckHeader(const RecordingHeader &header, size_t size) {
+    if (memcmp(header.magic, kRecordingMagic, sizeof(header.magic)) != 0 ||
+        header.version != 1 ||
+        !CheckImage(header.bgr_width, header.bgr_height, header.bgr_type) ||
+        (header.depth_type != -1 &&
+         !CheckImage(header.depth_width, header.depth_height,
+                     header.depth_type))) {
+        return false;
+    }
+    size_t min_stride =
+        sizeof(RecordingFrameHeader) +
+        AlignUp(ImageBytes(header.bgr_width, header.bgr_height,
+                           header.bgr_type)) +
+        AlignUp(ImageBytes(header.depth_width, header.depth_height,
+                           header.depth_type));
+    if (header.frame_stride < min_stride) {
+        return false;
+    }
+    if (header.num_frames == 0) {
+        // never closed, the frames are counted from the file size
+        return true;
+    }
+    // in divisions, the products could overflow
+    return header.index_offset >= kRecordingDataOffset &&
+           header.index_offset <= size &&
+           header.num_frames <= (size - header.index_offset) /
+                                    sizeof(RecordingIndexEntry) &&
+           header.num_frames <=
+               (size - kRecordingDataOffset) / header.frame_stride;
+}
+
+RecordingWriter::RecordingWriter(const std::string &path)
+    : fp(fopen(path.c_str(), "wb")), header(), padding(kRecordingAlignment) {
+    if (!this->fp) {
+        std::cout << "Failed to create recording " << path << std::endl;
+    }
+}
+
+RecordingWriter::~RecordingWriter() { Close(); }
+
+bool RecordingWriter::WriteImage(const cv::Mat &img, size_t padded_size) {
+    size_t row_size = img.cols * img.elemSize();
+    for (int y = 0; y < img.rows; y++) {
+        if (fwrite(img.ptr(y), row_size, 1, this->fp) != 1) {
+            return false;
+        }
+    }
+    size_t pad = padded_size - row_size * img.rows;
+    return pad == 0 || fwrite(this->padding.data(), pad, 1, this->fp) == 1;
+}
+
+bool RecordingWriter::Write(const cv::Mat &bgr, const cv::Mat &depth,
+                            int64_t bgr_timestamp, int64_t depth_timestamp) {
+    if (!this->fp || bgr.empty()) {
+        return false;
+    }
+    RecordingHeader &header = this->header;
+    if (this->index.empty()) {
+        memcpy(header.magic, kRecordingMagic, sizeof(header.magic));
+        header.version = 1;
+        header.bgr_width = bgr.cols;
+        header.bgr_height = bgr.rows;
+        header.bgr_type = bgr.type();
+        header.depth_width = depth.cols;
+        header.depth_height = depth.rows;
+        header.depth_type = depth.empty() ? -1 : depth.type();
+        header.frame_stride =
+            sizeof(RecordingFrameHeader) +
+            AlignUp(ImageBytes(bgr.cols, bgr.rows, bgr.type())) +
+            AlignUp(ImageBytes(depth.cols, depth.rows, header.depth_type));
+        // the header is rewritten with the frame count by Close()
+        std::vector<char> head(kRecordingDataOffset);
+        memcpy(head.data(), &header, sizeof(header));
+        if (fwrite(head.data(), head.size(), 1, this->fp) != 1) {
+            return false;
+        }
+    }
+    if (bgr.cols != header.bgr_width || bgr.rows != header.bgr_height ||
+        bgr.type() != header.bgr_type ||
+        (depth.empty() ? -1 : depth.type()) != header.depth_type ||
+        depth.cols != header.depth_width ||
+        depth.rows != header.depth_height) {
+        std::cout << "Recording frame geometry changed" << std::endl;
+        return false;
+    }
+
+    RecordingFrameHeader frame_header = {};
+    frame_header.magic = kRecordingFrameMagic;
+    frame_header.frame_index = this->index.size();
+    frame_header.bgr_timestamp = bgr_timestamp;
+    frame_header.depth_timestamp = depth_timestamp;
+    if (fwrite(&frame_header, sizeof(frame_header), 1, this->fp) != 1 ||
+        !WriteImage(bgr, AlignUp(ImageBytes(bgr.cols, bgr.rows,
+                                            header.bgr_type))) ||
+        !WriteImage(depth, AlignUp(ImageBytes(depth.cols, depth.rows,
+                                              header.depth_type)))) {
+        return false;
+    }
+    this->index.push_back(RecordingIndexEntry{bgr_timestamp, depth_timestamp});
+    return true;
+}
+
+void RecordingWriter::Close() {
+    if (!this->fp) {
+        return;
+    }
+    if (!this->index.empty()) {
+        this->header.num_frames = this->index.size();
+        this->header.index_offset =
+            kRecordingDataOffset +
+            this->header.num_frames * this->header.frame_stride;
+        fwrite(this->index.data(), sizeof(RecordingIndexEntry),
+               this->index.size(), this->fp);
+        fseek(this->fp, 0, SEEK_SET);
+        fwrite(&this->header, sizeof(this->header), 1, this->fp);
+    }
+    fclose(this->fp);
+    this->fp = nullptr;
+}
+
+RecordingReader::RecordingReader(const std::string &path, double fps,
+                                 bool loop)
+    : data(nullptr),
+      size(0),
+      header(),
+      next_frame(0),
+      current_frame(0),
+      pacer(fps),
+      loop(loop) {
+    int fd = open(path.c_str(), O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 ||
+        (size_t)st.st_size < kRecordingDataOffset) {
+        std::cout << "Failed to open recording " << path << std::endl;
+        if (fd >= 0) {
+            close(fd);
+        }
+        return;
+    }
+    void *mapping = mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cout << "Failed to map recording " << path << std::endl;
+        return;
+    }
+    this->data = (uint8_t *)mapping;
+    this->size = st.st_size;
+    memcpy(&this->header, this->data, sizeof(this->header));
+    const RecordingHeader &header = this->header;
+    if (!CheckHeader(header, this->size)) {
+        std::cout << path << " is not a recording or is corrupt"
+                  << std::endl;
+        munmap(this->data, this->size);
+        this->data = nullptr;
+        return;
+    }
+
+    if (header.num_frames > 0) {
+        const RecordingIndexEntry *index =
+            (const RecordingIndexEntry *)(this->data + header.index_offset);
+        this->index.assign(index, index + header.num_frames);
+    } else {
+        // never closed: every complete frame with a valid header counts
+        size_t count =
+            (this->size - kRecordingDataOffset) / header.frame_stride;
+        for (size_t i = 0; i < count; i++) {
+            const RecordingFrameHeader *frame_header =
+                (const RecordingFrameHeader *)Frame(i);
+            if (frame_header->magic != kRecordingFrameMagic ||
+                frame_header->frame_index != i) {
+                break;
+            }
+            this->index.push_back(RecordingIndexEntry{
+                frame_header->bgr_timestamp, frame_header->depth_timestamp});
+        }
+    }
+    // replay reads the frames front to back
+    madvise(this->data, this->size, MADV_SEQUENTIAL);
+}
+
+RecordingReader::~RecordingReader() {
+    if (this->data) {
+        munmap(this->data, this->size);
+    }
+}
+
+const uint8_t *RecordingReader::Frame(size_t i) const {
+    return this->data + kRecordingDataOffset + i * this->header.frame_stride;
+}
+
+cv::Mat RecordingReader::BGRImage(size_t i) const {
+    const RecordingHeader &header = this->header;
+    uint8_t *bgr = (uint8_t *)Frame(i) + sizeof(RecordingFrameHeader);
+    return cv::Mat(header.bgr_height, header.bgr_width, header.bgr_type, bgr);
+}
+
+cv::Mat RecordingReader::DepthImage(size_t i) const {
+    const RecordingHeader &header = this->header;
+    if (header.depth_type < 0) {
+        return cv::Mat();
+    }
+    uint8_t *depth = (uint8_t *)Frame(i) + sizeof(RecordingFrameHeader) +
+                     AlignUp(ImageBytes(header.bgr_width, header.bgr_height,
+                                        header.bgr_type));
+    return cv::Mat(header.depth_height, header.depth_width,
+                   header.depth_type, depth);
+}
+
+cv::Mat RecordingReader::ReadBGRImage() {
+    if (this->next_frame == this->index.size() && this->loop) {
+        this->next_frame = 0;
+    }
+    if (this->next_frame == this->index.size()) {
+        return cv::Mat();
+    }
+    this->pacer.Wait();
+    this->current_frame = this->next_frame++;
+    return BGRImage(this->current_frame);
+}
+
+cv::Mat RecordingReader::ReadDepthImage() {
+    if (this->index.empty()) {
+        return cv::Mat();
+    }
+    return DepthImage(this->current_frame);
+}
+
+void RecordingReader::GetShape(int *height, int *width) {
+    *height = this->header.bgr_height;
+    *width = this->header.bgr_width;
+}
+
+int64_t RecordingReader::BGRTimestamp() const {
+    return this->index.empty()
+               ? 0
+               : this->index[this->current_frame].bgr_timestamp;
+}
+
+int64_t RecordingReader::DepthTimestamp() const {
+    return this->index.empty()
+               ? 0
+               : this->index[this->current_frame].depth_timestamp;
+}
@@ -0,0 +1,116 @@
+// 2026-10-17 16:05
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <cstdint>
+#include <string>
+
+#include "common.h"
+#include "frame_source.h"
+
+// .rgbd recordings of RGB-D captures for I/O free replay:
+//
+//   RecordingHeader                        kRecordingDataOffset bytes
+//   frame 0 .. num_frames - 1              frame_stride bytes each
+//     RecordingFrameHeader                 kRecordingAlignment bytes
+//     BGR image, rows packed               padded to kRecordingAlignment
+//     depth image, rows packed             padded to kRecordingAlignment
+//   RecordingIndexEntry[num_frames]        written by Close()
+//
+// frames are fixed stride, so frame i is at kRecordingDataOffset +
+// i * frame_stride. the index makes the timestamps readable without
+// touching the frames; a recording that was never closed has no index and
+// is recovered from the frame headers instead.
+
+const char kRecordingMagic[8] = {'R', 'G', 'B', 'D', 'R', 'E', 'C', '1'};
+const uint32_t kRecordingFrameMagic = 0x46445247;  // "GRDF"
+const int kRecordingAlignment = 64;
+const int kRecordingDataOffset = 4096;
+
+struct RecordingHeader {
+    char magic[8];
+    uint32_t version;
+    // cv::Mat geometry, depth_type is -1 if there is no depth
+    int32_t bgr_width, bgr_height, bgr_type;
+    int32_t depth_width, depth_height, depth_type;
+    uint64_t frame_stride;
+    // 0 until Close()
+    uint64_t num_frames;
+    uint64_t index_offset;
+};
+
+struct RecordingFrameHeader {
+    uint32_t magic;
+    uint32_t frame_index;
+    int64_t bgr_timestamp;
+    int64_t depth_timestamp;
+    char reserved[kRecordingAlignment - 24];
+};
+
+struct RecordingIndexEntry {
+    int64_t bgr_timestamp;
+    int64_t depth_timestamp;
+};
+
+static_assert(sizeof(RecordingFrameHeader) == kRecordingAlignment,
+              "frame header must keep the images aligned");
+
+class RecordingWriter {
+   private:
+    FILE *fp;
+    RecordingHeader header;
+    std::vector<RecordingIndexEntry> index;
+    std::vector<char> padding;
+    bool WriteImage(const cv::Mat &img, size_t padded_size);
+
+   public:
+    explicit RecordingWriter(const std::string &path);
+    ~RecordingWriter();
+    bool IsOpened() const { return this->fp != nullptr; }
+    // the first frame fixes the geometry, later frames must match it.
+    // depth may be empty if the recording has no depth
+    bool Write(const cv::Mat &bgr, const cv::Mat &depth,
+               int64_t bgr_timestamp, int64_t depth_timestamp);
+    // writes the index and the final header, called by the destructor
+    void Close();
+};
+
+// maps the whole recording and hands out cv::Mat headers pointing into the
+// mapping: no decode and no copy per frame. the mapping is private, so a
+// caller drawing into a frame gets its own copy of the touched pages and
+// never modifies the file. the Mats are valid as long as the reader lives.
+class RecordingReader : public FrameSource {
+   private:
+    uint8_t *data;
+    size_t size;
+    RecordingHeader header;
+    std::vector<RecordingIndexEntry> index;
+    size_t next_frame;
+    size_t current_frame;
+    FramePacer pacer;
+    bool loop;
+    const uint8_t *Frame(size_t i) const;
+
+   public:
+    // fps <= 0 replays as fast as possible
+    explicit RecordingReader(const std::string &path, double fps = 0,
+                             bool loop = false);
+    ~RecordingReader();
+    bool IsOpened() const override { return this->data != nullptr; }
+    size_t NumFrames() const { return this->index.size(); }
+    cv::Mat BGRImage(size_t i) const;
+    cv::Mat DepthImage(size_t i) const;
+    const RecordingIndexEntry &Timestamps(size_t i) const {
+        return this->index[i];
+    }
+
+    // sequential replay through the FrameSource interface, ReadDepthImage
+    // returns the depth of the frame last returned by ReadBGRImage
+    cv::Mat ReadBGRImage() override;
+    cv::Mat ReadDepthImage() override;
+    void GetShape(int *height, int *width) override;
+    int64_t BGRTimestamp() const override;
+    int64_t DepthTimestamp() const override;
+};
+
+#endif  // RECORDING_H
@@ -0,0 +1,38 @@
+// 2026-10-17 23:59
+#ifndef SIMD_H
+#define SIMD_H
+
+// the SSE4.1 / AVX2 kernels of preprocess.cc and ssd_decoder.cc are
+// compiled for their instruction set with SIMD_TARGET, whatever -march the
+// build uses, and picked once at run time by SimdLevel(). so the default
+// build runs everywhere and still takes the fast paths where the CPU has
+// them. SSE2 is part of x86-64 and needs neither
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_X86 1
+#include <immintrin.h>
+#define SIMD_TARGET(isa) __attribute__((target(isa)))
+#endif
+
+enum SimdLevelType {
+    kSimdNone,
+    kSimdSSE41,
+    kSimdAVX2,
+};
+
+// the best of the levels above the CPU supports, detected on the first call
+inline SimdLevelType SimdLevel() {
+#if defined(SIMD_X86)
+    static const SimdLevelType level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return kSimdAVX2;
+        }
+        return __builtin_cpu_supports("sse4.1") ? kSimdSSE41 : kSimdNone;
+    }();
+    return level;
+#else
+    return kSimdNone;
+#endif
+}
+
+#endif  // SIMD_H
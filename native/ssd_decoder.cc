@@ -0,0 +1,252 @@
+#include "ssd_decoder.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "simd.h"
+#include "trace.h"
+
+// sigmoid is monotonic, so the score threshold can be compared against the
+// raw logits and the sigmoid only computed for the boxes that pass
+template <typename Spec>
+const float SsdDecoder<Spec>::kMinScoreLogit =
+    std::log(Spec::kMinScoreThresh / (1 - Spec::kMinScoreThresh));
+
+template <typename Spec>
+SsdDecoder<Spec>::SsdDecoder(int max_detections, NMSMode nms_mode)
+    : max_detections(max_detections > 0 ? max_detections : kNumBoxes),
+      nms_mode(nms_mode) {
+    static_assert(sizeof(Box) == (Spec::kNumCoords + 1) * sizeof(float),
+                  "Box coordinates must be laid out like the raw boxes");
+    this->decoded.reserve(kNumBoxes);
+    this->order.reserve(kNumBoxes);
+    this->suppressed.reserve(kNumBoxes);
+}
+
+static float sigmoid(float x) { return 1.0f / (1.0f + std::exp(-x)); }
+
+// the indices of scores[i..n) >= thresh appended to indices[count..),
+// returns the new count
+static inline int CompactFrom(const float *scores, int i, int n,
+                              float thresh, int *indices, int count) {
+#if defined(__SSE2__)
+    // x86-64 has SSE2, no target needed
+    __m128 thresh4 = _mm_set1_ps(thresh);
+    for (; i + 4 <= n; i += 4) {
+        __m128 v = _mm_loadu_ps(scores + i);
+        int mask = _mm_movemask_ps(_mm_cmpge_ps(v, thresh4));
+        while (mask) {
+            indices[count++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < n; i++) {
+        if (scores[i] >= thresh) {
+            indices[count++] = i;
+        }
+    }
+    return count;
+}
+
+#if defined(SIMD_X86)
+SIMD_TARGET("avx2")
+static int CompactAboveThresholdAVX2(const float *scores, int n,
+                                     float thresh, int *indices) {
+    int count = 0;
+    int i = 0;
+    __m256 thresh8 = _mm256_set1_ps(thresh);
+    for (; i + 8 <= n; i += 8) {
+        __m256 v = _mm256_loadu_ps(scores + i);
+        int mask = _mm256_movemask_ps(_mm256_cmp_ps(v, thresh8, _CMP_GE_OQ));
+        while (mask) {
+            indices[count++] = i + __builtin_ctz(mask);
+            mask &= mask - 1;
+        }
+    }
+    return CompactFrom(scores, i, n, thresh, indices, count);
+}
+#endif
+
+// writes the indices of scores >= thresh to `indices`, returns the count
+static int CompactAboveThreshold(const float *scores, int n, float thresh,
+                                 int *indices) {
+#if defined(SIMD_X86)
+    if (SimdLevel() == kSimdAVX2) {
+        return CompactAboveThresholdAVX2(scores, n, thresh, indices);
+    }
+#endif
+    return CompactFrom(scores, 0, n, thresh, indices, 0);
+}
+
+template <typename Spec>
+void SsdDecoder<Spec>::Calibrate(const float *raw_boxes,
+                                  const float *raw_scores) {
+    TRACE_SCOPE("Detector::Calibrate");
+    const int kImageWidth = Spec::kInputWidth;
+    const int kImageHeight = Spec::kInputHeight;
+    const int kNumCoords = Spec::kNumCoords;
+    int num_candidates = CompactAboveThreshold(
+        raw_scores, kNumBoxes, kMinScoreLogit, this->candidates);
+    this->decoded.resize(num_candidates);
+#if defined(__SSE2__)
+    const __m128 point_scale =
+        _mm_setr_ps(1.0f / kImageWidth, 1.0f / kImageHeight,
+                    1.0f / kImageWidth, 1.0f / kImageHeight);
+#endif
+    for (int k = 0; k < num_candidates; k++) {
+        int i = this->candidates[k];
+        const float *raw_box = raw_boxes + i * kNumCoords;
+        float anchor_x = kAnchors.x_center[i];
+        float anchor_y = kAnchors.y_center[i];
+        float anchor_w = kAnchors.w[i];
+        float anchor_h = kAnchors.h[i];
+        Box &box = this->decoded[k];
+        box.score = sigmoid(raw_scores[i]);
+        // x_min, y_min, w, h and the keypoints are stored like the raw box,
+        // decode them in place then turn the box center into its corner
+        float *coords = &box.x_min;
+        int j = 0;
+#if defined(__SSE2__)
+        // [x_center, y_center, w, h] / image size * anchor size + anchor center
+        __m128 box_scale =
+            _mm_setr_ps(anchor_w / kImageWidth, anchor_h / kImageHeight,
+                        anchor_w / kImageWidth, anchor_h / kImageHeight);
+        __m128 box_offset = _mm_setr_ps(anchor_x, anchor_y, 0, 0);
+        _mm_storeu_ps(coords, _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(raw_box),
+                                                    box_scale),
+                                         box_offset));
+        // keypoints: (x, y) / image size + anchor center
+        __m128 point_offset =
+            _mm_setr_ps(anchor_x, anchor_y, anchor_x, anchor_y);
+        for (j = 4; j + 4 <= kNumCoords; j += 4) {
+            _mm_storeu_ps(coords + j,
+                          _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(raw_box + j),
+                                                point_scale),
+                                     point_offset));
+        }
+#else
+        coords[0] = raw_box[0] / kImageWidth * anchor_w + anchor_x;
+        coords[1] = raw_box[1] / kImageHeight * anchor_h + anchor_y;
+        coords[2] = raw_box[2] / kImageWidth * anchor_w;
+        coords[3] = raw_box[3] / kImageHeight * anchor_h;
+        j = 4;
+#endif
+        for (; j < kNumCoords; j += 2) {
+            coords[j] = raw_box[j] / kImageWidth + anchor_x;
+            coords[j + 1] = raw_box[j + 1] / kImageHeight + anchor_y;
+        }
+        box.x_min -= box.w / 2;
+        box.y_min -= box.h / 2;
+    }
+}
+
+// the candidates are only ordered as far as they are consumed: building
+// the heap is O(n) and every pop O(log n), so with max_detections set
+// the boxes after the last picked one are never sorted nor compared
+template <typename Spec>
+int SsdDecoder<Spec>::PopBest() {
+    std::pop_heap(this->order.begin(), this->order.end());
+    int index = this->order.back().second;
+    this->order.pop_back();
+    return index;
+}
+
+template <typename Spec>
+std::vector<typename SsdDecoder<Spec>::Box> SsdDecoder<Spec>::NMS() {
+    return this->nms_mode == kNMSWeighted ? WeightedNMS() : HardNMS();
+}
+
+template <typename Spec>
+std::vector<typename SsdDecoder<Spec>::Box> SsdDecoder<Spec>::HardNMS() {
+    TRACE_SCOPE("Detector::NMS");
+    std::vector<Box> picked;
+    this->order.clear();
+    for (size_t i = 0; i < this->decoded.size(); i++) {
+        this->order.emplace_back(this->decoded[i].score, i);
+    }
+    std::make_heap(this->order.begin(), this->order.end());
+
+    // a box is suppressed iff it overlaps a box that was picked before it
+    while (!this->order.empty() &&
+           (int)picked.size() < this->max_detections) {
+        const Box &box = this->decoded[PopBest()];
+        bool suppressed = false;
+        for (const Box &best : picked) {
+            if (IOU(best, box) >= Spec::kNMSThresh) {
+                suppressed = true;
+                break;
+            }
+        }
+        if (!suppressed) {
+            picked.push_back(box);
+        }
+    }
+    return picked;
+}
+
+template <typename Spec>
+std::vector<typename SsdDecoder<Spec>::Box>
+SsdDecoder<Spec>::WeightedNMS() {
+    TRACE_SCOPE("Detector::WeightedNMS");
+    std::vector<Box> picked;
+    int num_boxes = this->decoded.size();
+    this->order.clear();
+    for (int i = 0; i < num_boxes; i++) {
+        this->order.emplace_back(this->decoded[i].score, i);
+    }
+    std::make_heap(this->order.begin(), this->order.end());
+    this->suppressed.assign(num_boxes, false);
+
+    while (!this->order.empty() &&
+           (int)picked.size() < this->max_detections) {
+        int best_index = PopBest();
+        if (this->suppressed[best_index]) {
+            continue;
+        }
+        const Box &best = this->decoded[best_index];
+        // score weighted sum of the best box and every remaining box
+        // overlapping it, the score stays the one of the best box
+        float weighted[Spec::kNumCoords];
+        const float *best_coords = &best.x_min;
+        for (int k = 0; k < Spec::kNumCoords; k++) {
+            weighted[k] = best_coords[k] * best.score;
+        }
+        float total_score = best.score;
+        this->suppressed[best_index] = true;
+        for (int j = 0; j < num_boxes; j++) {
+            const Box &box = this->decoded[j];
+            if (this->suppressed[j] || IOU(best, box) < Spec::kNMSThresh) {
+                continue;
+            }
+            this->suppressed[j] = true;
+            const float *coords = &box.x_min;
+            for (int k = 0; k < Spec::kNumCoords; k++) {
+                weighted[k] += coords[k] * box.score;
+            }
+            total_score += box.score;
+        }
+        Box box = best;
+        float *coords = &box.x_min;
+        for (int k = 0; k < Spec::kNumCoords; k++) {
+            coords[k] = weighted[k] / total_score;
+        }
+        picked.push_back(box);
+    }
+    return picked;
+}
+
+template <typename Spec>
+float SsdDecoder<Spec>::IOU(const Box &a, const Box &b) {
+    float x1 = std::max(a.x_min, b.x_min);
+    float y1 = std::max(a.y_min, b.y_min);
+    float x2 = std::min(a.x_min + a.w, b.x_min + b.w);
+    float y2 = std::min(a.y_min + a.h, b.y_min + b.h);
+    float w = std::max(0.0f, x2 - x1);
+    float h = std::max(0.0f, y2 - y1);
+    float intersection = w * h;
+    return intersection / (a.w * a.h + b.w * b.h - intersection);
+}
+
+template class SsdDecoder<FaceDetectionSpec>;
+template class SsdDecoder<PalmDetectionSpec>;
@@ -0,0 +1,69 @@
+// 2026-10-17 19:40
+#ifndef SSD_DECODER_H
+#define SSD_DECODER_H
+
+#include <utility>
+#include <vector>
+
+#include "ssd_spec.h"
+
+template <int kNumKeyPoints>
+struct BasicBox {
+    float score;
+    float x_min, y_min;
+    float w, h;
+    float keypoints[kNumKeyPoints][2];
+};
+
+enum NMSMode {
+    // keep the best box and drop every box overlapping it
+    kNMSHard,
+    // MediaPipe's weighted NMS: the overlapping boxes are averaged into the
+    // best one, weighted by their scores
+    kNMSWeighted,
+};
+
+// the model independent half of SsdDetector: turns the raw SSD outputs
+// into boxes in normalized (0-1) input image coordinates. no TFLite, so
+// it also serves models run elsewhere (pyext/box_decoder.cc)
+template <typename Spec>
+class SsdDecoder {
+   public:
+    static constexpr int kNumBoxes = NumAnchors<Spec>();
+    typedef BasicBox<Spec::kNumKeyPoints> Box;
+
+   private:
+    // structure of arrays, the decoder only touches the anchors of the
+    // boxes that passed the score threshold
+    static constexpr AnchorTable<kNumBoxes> kAnchors = MakeAnchors<Spec>();
+    static const float kMinScoreLogit;
+    int max_detections;
+    NMSMode nms_mode;
+    // scratch buffers, reserved for kNumBoxes once so that a frame never
+    // allocates: indices of the boxes whose score passed
+    // Spec::kMinScoreThresh, their decoded boxes, a max-heap of
+    // (score, index) into `decoded` and the NMS bookkeeping
+    int candidates[kNumBoxes];
+    std::vector<Box> decoded;
+    std::vector<std::pair<float, int>> order;
+    std::vector<char> suppressed;
+    std::vector<Box> HardNMS();
+    std::vector<Box> WeightedNMS();
+    int PopBest();
+    static float IOU(const Box &a, const Box &b);
+
+   public:
+    // max_detections <= 0 keeps every box that survives NMS
+    explicit SsdDecoder(int max_detections = 0, NMSMode nms_mode = kNMSHard);
+    // raw_boxes is [kNumBoxes][Spec::kNumCoords], raw_scores the
+    // [kNumBoxes] score logits. decodes the boxes above the score threshold
+    void Calibrate(const float *raw_boxes, const float *raw_scores);
+    // the boxes of the last Calibrate() that survive NMS, best first
+    std::vector<Box> NMS();
+    std::vector<Box> Decode(const float *raw_boxes, const float *raw_scores) {
+        Calibrate(raw_boxes, raw_scores);
+        return NMS();
+    }
+};
+
+#endif  // SSD_DECODER_H
@@ -0,0 +1,84 @@
+// 2026-10-17 11:05
+#ifndef SSD_SPEC_H
+#define SSD_SPEC_H
+
+#include "config.h"
+
+// MediaPipe SSD style detectors: every layer has a feature map of
+// ceil(input / stride) cells with kAnchorsPerCell anchors per cell, all
+// anchors have a fixed size of 1.0. The model outputs kNumCoords raw
+// values per anchor (x_center, y_center, w, h, then kNumKeyPoints (x, y))
+// and one score logit per anchor.
+struct FaceDetectionSpec {
+    static constexpr const char *kModelFileName = kFaceDetectionModel;
+    static constexpr int kInputWidth = 128;
+    static constexpr int kInputHeight = 128;
+    static constexpr int kNumCoords = 16;
+    static constexpr int kNumKeyPoints = 6;
+    static constexpr int kNumLayers = 2;
+    static constexpr int kStrides[kNumLayers] = {8, 16};
+    static constexpr int kAnchorsPerCell[kNumLayers] = {2, 6};
+    static constexpr float kMinScoreThresh = 0.68f;
+    static constexpr float kNMSThresh = 0.5f;
+};
+
+struct PalmDetectionSpec {
+    static constexpr const char *kModelFileName = kPalmDetectionModel;
+    static constexpr int kInputWidth = 128;
+    static constexpr int kInputHeight = 128;
+    static constexpr int kNumCoords = 18;
+    static constexpr int kNumKeyPoints = 7;
+    static constexpr int kNumLayers = 2;
+    static constexpr int kStrides[kNumLayers] = {8, 16};
+    static constexpr int kAnchorsPerCell[kNumLayers] = {2, 6};
+    static constexpr float kMinScoreThresh = 0.8f;
+    static constexpr float kNMSThresh = 0.5f;
+};
+
+template <int N>
+struct AnchorTable {
+    float x_center[N];
+    float y_center[N];
+    float w[N];
+    float h[N];
+};
+
+template <typename Spec>
+constexpr int NumAnchors() {
+    int count = 0;
+    for (int i = 0; i < Spec::kNumLayers; i++) {
+        int stride = Spec::kStrides[i];
+        int height = (Spec::kInputHeight + stride - 1) / stride;
+        int width = (Spec::kInputWidth + stride - 1) / stride;
+        count += height * width * Spec::kAnchorsPerCell[i];
+    }
+    return count;
+}
+
+template <typename Spec, int N = NumAnchors<Spec>()>
+constexpr AnchorTable<N> MakeAnchors() {
+    AnchorTable<N> anchors{};
+    int anchor_index = 0;
+    for (int i = 0; i < Spec::kNumLayers; i++) {
+        int stride = Spec::kStrides[i];
+        int height = (Spec::kInputHeight + stride - 1) / stride;
+        int width = (Spec::kInputWidth + stride - 1) / stride;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                for (int k = 0; k < Spec::kAnchorsPerCell[i]; k++) {
+                    anchors.x_center[anchor_index] = (x + 0.5f) / width;
+                    anchors.y_center[anchor_index] = (y + 0.5f) / height;
+                    anchors.w[anchor_index] = 1.0f;
+                    anchors.h[anchor_index] = 1.0f;
+                    anchor_index++;
+                }
+            }
+        }
+    }
+    return anchors;
+}
+
+static_assert(NumAnchors<FaceDetectionSpec>() == 896, "face anchors");
+static_assert(NumAnchors<PalmDetectionSpec>() == 896, "palm anchors");
+
+#endif  // SSD_SPEC_H
@@ -1,25 +1,168 @@
 #include "nn_tflite.h"
 
-#include "../config.h"
-
-NNTFLite::NNTFLite(float *feature_buffer, float *output_buffer)
-    : model(tflite::FlatBufferModel::BuildFromFile(kModelFileName)),
-      builder(*model, resolver),
-      feature_buffer(feature_buffer),
-      output_buffer(output_buffer) {
-    printf("%p\n", feature_buffer);
-    builder(&this->interpreter);
+#include <algorithm>
+#include <iostream>
+
+#include "trace.h"
+
+namespace {
+struct SharedCpuBackend {
+    std::mutex mutex;
+    std::unique_ptr<ExternalCpuBackendContext> context;
+    int num_threads = -1;
+};
+
+// never destroyed: interpreters clear their caches on the shared context
+// when they go away, which may happen during static destruction
+SharedCpuBackend &GetSharedCpuBackend() {
+    static SharedCpuBackend *backend = new SharedCpuBackend();
+    return *backend;
+}
+}  // namespace
+
+void NNTFLite::ShareCpuBackend(int num_threads) {
+    SharedCpuBackend &backend = GetSharedCpuBackend();
+    std::lock_guard<std::mutex> lock(backend.mutex);
+    if (!backend.context) {
+        backend.context.reset(new ExternalCpuBackendContext());
+    }
+    backend.num_threads = num_threads;
+}
+
+static TensorInfo GetTensorInfo(const TfLiteTensor* tensor) {
+    TensorInfo info{tensor->name ? tensor->name : "", tensor->type, {},
+                    tensor->bytes};
+    for (int i = 0; i < tensor->dims->size; i++) {
+        info.shape.push_back(tensor->dims->data[i]);
+    }
+    return info;
+}
+
+// span of the non-persistent arena: every kTfLiteArenaRw tensor lives in it
+static size_t GetArenaBytes(const Interpreter* interpreter) {
+    uintptr_t begin = UINTPTR_MAX;
+    uintptr_t end = 0;
+    for (size_t i = 0; i < interpreter->tensors_size(); i++) {
+        const TfLiteTensor* tensor = interpreter->tensor(i);
+        if (tensor->allocation_type != kTfLiteArenaRw || !tensor->data.raw) {
+            continue;
+        }
+        uintptr_t data = (uintptr_t)tensor->data.raw;
+        begin = std::min(begin, data);
+        end = std::max(end, data + tensor->bytes);
+    }
+    return end > begin ? end - begin : 0;
+}
+
+size_t ArenaGroup::ResidentBytes() const {
+    size_t bytes = 0;
+    for (const NNTFLite* member : this->members) {
+        bytes = std::max(bytes, member->ArenaBytes());
+    }
+    return bytes;
+}
+
+void ArenaGroup::Report() const {
+    size_t resident = ResidentBytes();
+    size_t total = 0;
+    bool largest_seen = false;
+    for (const NNTFLite* member : this->members) {
+        // the largest arena is the one the group effectively keeps
+        size_t saved = member->ArenaBytes();
+        if (saved == resident && !largest_seen) {
+            largest_seen = true;
+            saved = 0;
+        }
+        total += member->ArenaBytes();
+        printf("%-48s arena %9zu bytes, saved %9zu bytes\n",
+               member->ModelFile().c_str(), member->ArenaBytes(), saved);
+    }
+    printf("arena group: %zu bytes resident instead of %zu\n", resident,
+           total);
+}
+
+NNTFLite::NNTFLite(const std::string& model_file, ArenaGroup* arena_group)
+    : model_file(model_file),
+      model(tflite::FlatBufferModel::BuildFromFile(model_file.c_str())),
+      shared_backend(false),
+      arena_group(arena_group),
+      arena_bytes(0) {
+    if (!this->model) {
+        std::cout << "Failed to load model " << model_file << std::endl;
+        exit(-1);
+    }
+#ifdef NN_MINIMAL_OP_RESOLVER
+    RegisterUsedOps(&this->resolver);
+#endif
+    InterpreterBuilder builder(*this->model, this->resolver);
+    if (builder(&this->interpreter) != kTfLiteOk) {
+        std::cout << "Failed to build interpreter for " << model_file
+                  << std::endl;
+        exit(-1);
+    }
+    // the backend has to be in place before the kernels are prepared
+    SharedCpuBackend &backend = GetSharedCpuBackend();
+    {
+        std::lock_guard<std::mutex> lock(backend.mutex);
+        if (backend.context) {
+            this->shared_backend = true;
+            this->interpreter->SetExternalContext(kTfLiteCpuBackendContext,
+                                                  backend.context.get());
+            this->interpreter->SetNumThreads(backend.num_threads);
+        }
+    }
+    if (this->interpreter->AllocateTensors() != kTfLiteOk) {
+        std::cout << "Failed to allocate tensors for " << model_file
+                  << std::endl;
+        exit(-1);
+    }
+    for (int index : this->interpreter->inputs()) {
+        this->inputs.push_back(GetTensorInfo(this->interpreter->tensor(index)));
+    }
+    for (int index : this->interpreter->outputs()) {
+        this->outputs.push_back(
+            GetTensorInfo(this->interpreter->tensor(index)));
+    }
+    this->arena_bytes = GetArenaBytes(this->interpreter.get());
+    if (this->arena_group) {
+        // joins released, the arena comes back when this model runs
+        this->interpreter->ReleaseNonPersistentMemory();
+        this->arena_group->members.push_back(this);
+    }
+}
+
+NNTFLite::~NNTFLite() {
+    if (this->arena_group) {
+        std::vector<NNTFLite*>& members = this->arena_group->members;
+        members.erase(std::remove(members.begin(), members.end(), this),
+                      members.end());
+        if (this->arena_group->holder == this) {
+            this->arena_group->holder = nullptr;
+        }
+    }
+}
+
+// with the plan unchanged, AllocateTensors only re-acquires the released
+// arena and re-points the tensors into it
+void NNTFLite::Acquire() {
+    if (!this->arena_group || this->arena_group->holder == this) {
+        return;
+    }
+    NNTFLite* holder = this->arena_group->holder;
+    if (holder) {
+        holder->interpreter->ReleaseNonPersistentMemory();
+    }
     this->interpreter->AllocateTensors();
+    this->arena_group->holder = this;
 }
 
 void NNTFLite::Invoke() {
-    float *model_input = this->interpreter->typed_input_tensor<float>(0);
-    memcpy(model_input, this->feature_buffer, sizeof(float) * kImageSize);
+    TRACE_SCOPE("NNTFLite::Invoke");
+    Acquire();
+    if (this->shared_backend) {
+        std::lock_guard<std::mutex> lock(GetSharedCpuBackend().mutex);
+        this->interpreter->Invoke();
+        return;
+    }
     this->interpreter->Invoke();
-    float *regressors = interpreter->typed_output_tensor<float>(0);
-    float *classificators = interpreter->typed_output_tensor<float>(1);
-    memcpy(this->output_buffer, regressors,
-           kNumBoxes * kNumCoords * sizeof(float));
-    memcpy(this->output_buffer + kNumBoxes * kNumCoords, classificators,
-           kNumBoxes * sizeof(float));
 }
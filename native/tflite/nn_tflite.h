@@ -2,28 +2,125 @@
 #define NN_TFLITE_H
 #include <unistd.h>
 
+#include <cassert>
 #include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
 
+#include "tensorflow/lite/external_cpu_backend_context.h"
 #include "tensorflow/lite/interpreter.h"
 #include "tensorflow/lite/kernels/register.h"
 #include "tensorflow/lite/model.h"
 #include "tensorflow/lite/optional_debug_tools.h"
 using namespace tflite;
 
+// shape and type of an input/output tensor, read back from the model
+struct TensorInfo {
+    std::string name;
+    TfLiteType type;
+    std::vector<int> shape;
+    size_t bytes;
+};
+
+#ifdef NN_MINIMAL_OP_RESOLVER
+// registers only the kernels the shipped models use, generated into
+// tflite/op_resolver_gen.cc by `make op_resolver`. linking against it
+// instead of BuiltinOpResolver lets the linker drop every other kernel.
+void RegisterUsedOps(MutableOpResolver* resolver);
+#endif
+
+class NNTFLite;
+
+// interpreters that never run at the same time (e.g. face detection, face
+// landmark and iris landmark in one pipeline thread) can join an
+// ArenaGroup: only the member that ran last keeps its non-persistent
+// arena (activations and intermediates), the others are released and
+// re-acquired the next time they run. The resident arena memory of the
+// group is then the largest member's arena instead of the sum.
+class ArenaGroup {
+   private:
+    friend class NNTFLite;
+    std::vector<NNTFLite*> members;
+    NNTFLite* holder;
+
+   public:
+    ArenaGroup() : holder(nullptr) {}
+    // resident arena bytes of the group, i.e. the largest member's arena
+    size_t ResidentBytes() const;
+    // prints the arena size and the bytes saved by every member
+    void Report() const;
+};
+
 class NNTFLite {
    private:
+    std::string model_file;
     std::unique_ptr<Interpreter> interpreter;
     std::unique_ptr<FlatBufferModel> model;
+#ifdef NN_MINIMAL_OP_RESOLVER
+    MutableOpResolver resolver;
+#else
     ops::builtin::BuiltinOpResolver resolver;
-    InterpreterBuilder builder;
-
-    float* feature_buffer;
-    float* output_buffer;
+#endif
+    std::vector<TensorInfo> inputs;
+    std::vector<TensorInfo> outputs;
+    // set when the interpreter runs on the process-wide cpu backend
+    bool shared_backend;
+    ArenaGroup* arena_group;
+    size_t arena_bytes;
+    void Acquire();
 
    public:
-    NNTFLite(float* feature_buffer, float* output_buffer);
+    // every NNTFLite created after this call attaches to one process-wide
+    // cpu backend context, i.e. one thread pool of num_threads workers,
+    // instead of each interpreter spinning up its own. tflite can't run two
+    // interpreters on the same backend context at once, so Invoke() is
+    // serialized among the sharing instances: interpreters invoked from
+    // different threads wait for each other. meant for stages that run one
+    // after another anyway (a Graph, face_detector.elf), whose threads then
+    // don't oversubscribe the cores; leave interpreters that should run in
+    // parallel on their own contexts.
+    static void ShareCpuBackend(int num_threads);
+
+    // every instance owns its model and interpreter, so several models can
+    // be loaded side by side in one process
+    explicit NNTFLite(const std::string& model_file,
+                      ArenaGroup* arena_group = nullptr);
+    ~NNTFLite();
 
     void Invoke();
+
+    // op level profiling, the profiler is not owned and nullptr detaches it
+    void SetProfiler(Profiler* profiler) {
+        this->interpreter->SetProfiler(profiler);
+    }
+    // read only view of the graph (nodes, registrations, tensors) for tools
+    const Interpreter& GetInterpreter() const { return *this->interpreter; }
+
+    const std::string& ModelFile() const { return this->model_file; }
+    // size of the non-persistent arena
+    size_t ArenaBytes() const { return this->arena_bytes; }
+    int NumInputs() const { return this->inputs.size(); }
+    int NumOutputs() const { return this->outputs.size(); }
+    const TensorInfo& Input(int index) const { return this->inputs[index]; }
+    const TensorInfo& Output(int index) const { return this->outputs[index]; }
+
+    // views of the interpreter's own tensors, callers write the input and
+    // read the outputs in place instead of going through a staging buffer.
+    // the pointers stay valid as long as the tensors are not re-allocated,
+    // in an ArenaGroup until another member of the group runs
+    template <typename T>
+    T* InputTensor(int index) {
+        assert(this->inputs[index].type == typeToTfLiteType<T>());
+        Acquire();
+        return this->interpreter->typed_input_tensor<T>(index);
+    }
+    template <typename T>
+    T* OutputTensor(int index) {
+        assert(this->outputs[index].type == typeToTfLiteType<T>());
+        Acquire();
+        return this->interpreter->typed_output_tensor<T>(index);
+    }
 };
 
 #endif
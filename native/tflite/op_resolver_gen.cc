@@ -0,0 +1,65 @@
+// generated by tools/gen_op_resolver.elf from:
+//   ../model/face_detection_front.tflite
+//   ../model/face_landmark.tflite
+//   ../model/hand_landmark.tflite
+//   ../model/iris_landmark.tflite
+//   ../model/object_detection.tflite
+//   ../model/palm_detection.tflite
+// do not edit, run `make op_resolver` instead
+#include "nn_tflite.h"
+
+#ifdef NN_MINIMAL_OP_RESOLVER
+namespace tflite {
+namespace ops {
+namespace builtin {
+TfLiteRegistration *Register_ADD();
+TfLiteRegistration *Register_CONCATENATION();
+TfLiteRegistration *Register_CONV_2D();
+TfLiteRegistration *Register_DEPTHWISE_CONV_2D();
+TfLiteRegistration *Register_DEQUANTIZE();
+TfLiteRegistration *Register_FULLY_CONNECTED();
+TfLiteRegistration *Register_LOGISTIC();
+TfLiteRegistration *Register_MAX_POOL_2D();
+TfLiteRegistration *Register_PAD();
+TfLiteRegistration *Register_PRELU();
+TfLiteRegistration *Register_RELU();
+TfLiteRegistration *Register_RESHAPE();
+TfLiteRegistration *Register_RESIZE_BILINEAR();
+}  // namespace builtin
+namespace custom {
+TfLiteRegistration *Register_DETECTION_POSTPROCESS();
+}  // namespace custom
+}  // namespace ops
+}  // namespace tflite
+
+void RegisterUsedOps(MutableOpResolver* resolver) {
+    resolver->AddBuiltin(BuiltinOperator_ADD,
+                         ops::builtin::Register_ADD(), 1, 1);
+    resolver->AddBuiltin(BuiltinOperator_CONCATENATION,
+                         ops::builtin::Register_CONCATENATION(), 1, 1);
+    resolver->AddBuiltin(BuiltinOperator_CONV_2D,
+                         ops::builtin::Register_CONV_2D(), 1, 1);
+    resolver->AddBuiltin(BuiltinOperator_DEPTHWISE_CONV_2D,
+                         ops::builtin::Register_DEPTHWISE_CONV_2D(), 1, 1);
+    resolver->AddBuiltin(BuiltinOperator_DEQUANTIZE,
+                         ops::builtin::Register_DEQUANTIZE(), 2, 2);
+    resolver->AddBuiltin(BuiltinOperator_FULLY_CONNECTED,
+                         ops::builtin::Register_FULLY_CONNECTED(), 1, 1);
+    resolver->AddBuiltin(BuiltinOperator_LOGISTIC,
+                         ops::builtin::Register_LOGISTIC(), 1, 1);
+    resolver->AddBuiltin(BuiltinOperator_MAX_POOL_2D,
+                         ops::builtin::Register_MAX_POOL_2D(), 1, 1);
+    resolver->AddBuiltin(BuiltinOperator_PAD,
+                         ops::builtin::Register_PAD(), 1, 1);
+    resolver->AddBuiltin(BuiltinOperator_PRELU,
+                         ops::builtin::Register_PRELU(), 1, 1);
+    resolver->AddBuiltin(BuiltinOperator_RELU,
+                         ops::builtin::Register_RELU(), 1, 1);
+    resolver->AddBuiltin(BuiltinOperator_RESHAPE,
+                         ops::builtin::Register_RESHAPE(), 1, 1);
+    resolver->AddBuiltin(BuiltinOperator_RESIZE_BILINEAR,
+                         ops::builtin::Register_RESIZE_BILINEAR(), 1, 1);
+    resolver->AddCustom("TFLite_Detection_PostProcess",
+                        ops::custom::Register_DETECTION_POSTPROCESS(), 1, 1);
+}
+#endif  // NN_MINIMAL_OP_RESOLVER
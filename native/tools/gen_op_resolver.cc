@@ -0,0 +1,108 @@
+// reads .tflite models against the vendored schema and prints a
+// RegisterUsedOps() that adds exactly the kernels (and versions) they use
+// to a MutableOpResolver, see NN_MINIMAL_OP_RESOLVER in tflite/nn_tflite.h
+//
+// usage: gen_op_resolver.elf model.tflite... > tflite/op_resolver_gen.cc
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+
+#include "tensorflow/lite/schema/schema_generated.h"
+
+struct VersionRange {
+    int min_version;
+    int max_version;
+};
+
+// custom ops we know how to register, name -> registration function
+static const std::map<std::string, std::string> kCustomOps = {
+    {"TFLite_Detection_PostProcess", "Register_DETECTION_POSTPROCESS"},
+};
+
+static void AddVersion(VersionRange &range, int version) {
+    range.min_version = std::min(range.min_version, version);
+    range.max_version = std::max(range.max_version, version);
+}
+
+int main(int argc, char *argv[]) {
+    std::map<std::string, VersionRange> builtins;
+    std::map<std::string, VersionRange> customs;
+    for (int i = 1; i < argc; i++) {
+        std::ifstream file(argv[i], std::ios::binary);
+        if (!file) {
+            std::cerr << "can't open " << argv[i] << std::endl;
+            return -1;
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        std::string data = buffer.str();
+        flatbuffers::Verifier verifier((const uint8_t *)data.data(),
+                                       data.size());
+        if (!tflite::VerifyModelBuffer(verifier)) {
+            std::cerr << argv[i] << " is not a valid tflite model"
+                      << std::endl;
+            return -1;
+        }
+        const tflite::Model *model = tflite::GetModel(data.data());
+        for (const tflite::OperatorCode *op : *model->operator_codes()) {
+            int version = op->version();
+            if (op->builtin_code() == tflite::BuiltinOperator_CUSTOM) {
+                std::string name = op->custom_code()->str();
+                if (!kCustomOps.count(name)) {
+                    std::cerr << argv[i] << ": unknown custom op " << name
+                              << std::endl;
+                    return -1;
+                }
+                customs.emplace(name, VersionRange{version, version});
+                AddVersion(customs[name], version);
+            } else {
+                std::string name =
+                    tflite::EnumNameBuiltinOperator(op->builtin_code());
+                builtins.emplace(name, VersionRange{version, version});
+                AddVersion(builtins[name], version);
+            }
+        }
+    }
+
+    std::cout << "// generated by tools/gen_op_resolver.elf from:\n";
+    for (int i = 1; i < argc; i++) {
+        std::cout << "//   " << argv[i] << "\n";
+    }
+    std::cout << "// do not edit, run `make op_resolver` instead\n"
+              << "#include \"nn_tflite.h\"\n\n"
+              << "#ifdef NN_MINIMAL_OP_RESOLVER\n"
+              << "namespace tflite {\n"
+              << "namespace ops {\n"
+              << "namespace builtin {\n";
+    for (auto &op : builtins) {
+        std::cout << "TfLiteRegistration *Register_" << op.first << "();\n";
+    }
+    std::cout << "}  // namespace builtin\n"
+              << "namespace custom {\n";
+    for (auto &op : customs) {
+        std::cout << "TfLiteRegistration *" << kCustomOps.at(op.first)
+                  << "();\n";
+    }
+    std::cout << "}  // namespace custom\n"
+              << "}  // namespace ops\n"
+              << "}  // namespace tflite\n\n"
+              << "void RegisterUsedOps(MutableOpResolver* resolver) {\n";
+    for (auto &op : builtins) {
+        std::cout << "    resolver->AddBuiltin(BuiltinOperator_" << op.first
+                  << ",\n                         ops::builtin::Register_"
+                  << op.first << "(), " << op.second.min_version << ", "
+                  << op.second.max_version << ");\n";
+    }
+    for (auto &op : customs) {
+        std::cout << "    resolver->AddCustom(\"" << op.first
+                  << "\",\n                        ops::custom::"
+                  << kCustomOps.at(op.first) << "(), "
+                  << op.second.min_version << ", " << op.second.max_version
+                  << ");\n";
+    }
+    std::cout << "}\n"
+              << "#endif  // NN_MINIMAL_OP_RESOLVER\n";
+    return 0;
+}
@@ -0,0 +1,247 @@
+// per op latency of tflite models: runs every model N times with an op
+// level profiler attached and prints, for every node in execution order,
+// its op type, shapes, mean time, share of the total and the achieved
+// GFLOP/s against a static FLOP estimate (EstimateFlops, mostly that of
+// python/tools/count_flops.py, see there), followed by a summary per op
+// type
+//
+// usage: op_profiler.elf [-n runs] [-w warmup] [-t threads] model.tflite...
+#include <getopt.h>
+
+#include <algorithm>
+#include <map>
+
+#include "../common.h"
+#include "../tflite/nn_tflite.h"
+
+// accumulates the wall time of every OPERATOR_INVOKE_EVENT of the primary
+// subgraph per node index
+class OpProfiler : public Profiler {
+   private:
+    struct Event {
+        int node_index;  // -1: not an op of the primary subgraph
+        steady_clock::time_point start;
+    };
+    std::vector<Event> events;
+    std::vector<double> total_us;
+
+   public:
+    explicit OpProfiler(int num_nodes) : total_us(num_nodes, 0) {}
+
+    uint32_t BeginEvent(const char* tag, EventType event_type,
+                        uint32_t event_metadata,
+                        uint32_t event_subgraph_index) override {
+        int node_index = -1;
+        if (event_type == EventType::OPERATOR_INVOKE_EVENT &&
+            event_subgraph_index == 0 &&
+            event_metadata < this->total_us.size()) {
+            node_index = event_metadata;
+        }
+        this->events.push_back(Event{node_index, steady_clock::now()});
+        return this->events.size() - 1;
+    }
+
+    void EndEvent(uint32_t event_handle) override {
+        const Event& event = this->events[event_handle];
+        if (event.node_index >= 0) {
+            this->total_us[event.node_index] +=
+                duration_cast<nanoseconds>(steady_clock::now() - event.start)
+                    .count() /
+                1000.0;
+        }
+        // events are strictly nested, the handles can be reused once the
+        // outermost one is closed
+        if (event_handle == 0) {
+            this->events.clear();
+        }
+    }
+
+    void Reset() { std::fill(total_us.begin(), total_us.end(), 0); }
+    double TotalUs(int node_index) const {
+        return this->total_us[node_index];
+    }
+};
+
+static const TfLiteTensor* NodeTensor(const Interpreter& interpreter,
+                                      const TfLiteIntArray* indices,
+                                      int i) {
+    if (i >= indices->size || indices->data[i] < 0) {
+        return nullptr;
+    }
+    return interpreter.tensor(indices->data[i]);
+}
+
+static int64_t NumElements(const TfLiteTensor* tensor) {
+    int64_t count = 1;
+    for (int i = 0; i < tensor->dims->size; i++) {
+        count *= tensor->dims->data[i];
+    }
+    return count;
+}
+
+static std::string ShapeString(const TfLiteTensor* tensor) {
+    std::string shape;
+    for (int i = 0; i < tensor->dims->size; i++) {
+        shape += (i ? "x" : "") + std::to_string(tensor->dims->data[i]);
+    }
+    return shape;
+}
+
+static std::string OpName(const TfLiteRegistration& registration) {
+    if (registration.builtin_code == BuiltinOperator_CUSTOM) {
+        return registration.custom_name;
+    }
+    return EnumNameBuiltinOperator(
+        (BuiltinOperator)registration.builtin_code);
+}
+
+// the formulas of python/tools/count_flops.py, 0 for the ops it ignores,
+// except DEPTHWISE_CONV_2D: count_flops.py multiplies the first three
+// filter dims (1 * a * b) and leaves out the c channels, here every
+// channel is counted like for CONV_2D
+static int64_t EstimateFlops(const Interpreter& interpreter,
+                             const TfLiteNode& node,
+                             const TfLiteRegistration& registration) {
+    const TfLiteTensor* input = NodeTensor(interpreter, node.inputs, 0);
+    const TfLiteTensor* filter = NodeTensor(interpreter, node.inputs, 1);
+    const TfLiteTensor* output = NodeTensor(interpreter, node.outputs, 0);
+    switch (registration.builtin_code) {
+        case BuiltinOperator_CONV_2D:
+        case BuiltinOperator_DEPTHWISE_CONV_2D:
+            // filter [o, a, b, c] resp. [1, a, b, c], output [1, x, y, o]
+            if (!filter || !output || output->dims->size != 4) {
+                return 0;
+            }
+            return NumElements(filter) * output->dims->data[1] *
+                   output->dims->data[2] * 2;
+        case BuiltinOperator_ADD:
+            return input ? NumElements(input) : 0;
+        case BuiltinOperator_FULLY_CONNECTED:
+            return filter ? NumElements(filter) * 2 : 0;
+        default:
+            return 0;
+    }
+}
+
+struct OpStats {
+    double total_us;
+    int64_t flops;
+    int count;
+};
+
+static void Profile(const std::string& model_file, int runs, int warmup) {
+    NNTFLite nn(model_file);
+    const Interpreter& interpreter = nn.GetInterpreter();
+    const std::vector<int>& plan = interpreter.execution_plan();
+    OpProfiler profiler(interpreter.nodes_size());
+
+    for (int i = 0; i < warmup; i++) {
+        nn.Invoke();
+    }
+    nn.SetProfiler(&profiler);
+    steady_clock::time_point start = steady_clock::now();
+    for (int i = 0; i < runs; i++) {
+        nn.Invoke();
+    }
+    double invoke_us =
+        duration_cast<nanoseconds>(steady_clock::now() - start).count() /
+        1000.0 / runs;
+    nn.SetProfiler(nullptr);
+
+    double ops_us = 0;
+    for (int node_index : plan) {
+        ops_us += profiler.TotalUs(node_index) / runs;
+    }
+
+    printf("%s: %d runs, invoke %.1f us, ops %.1f us\n", model_file.c_str(),
+           runs, invoke_us, ops_us);
+    printf("%4s %-20s %-28s %-16s %9s %6s %9s %8s\n", "node", "op", "input",
+           "output", "mean(us)", "share", "MFLOP", "GFLOP/s");
+    std::map<std::string, OpStats> by_type;
+    int64_t total_flops = 0;
+    for (int node_index : plan) {
+        const auto* node_and_registration =
+            interpreter.node_and_registration(node_index);
+        const TfLiteNode& node = node_and_registration->first;
+        const TfLiteRegistration& registration =
+            node_and_registration->second;
+        std::string op = OpName(registration);
+        const TfLiteTensor* input = NodeTensor(interpreter, node.inputs, 0);
+        const TfLiteTensor* output = NodeTensor(interpreter, node.outputs, 0);
+        double mean_us = profiler.TotalUs(node_index) / runs;
+        int64_t flops = EstimateFlops(interpreter, node, registration);
+        total_flops += flops;
+
+        printf("%4d %-20s %-28s %-16s %9.1f %5.1f%%", node_index, op.c_str(),
+               input ? ShapeString(input).c_str() : "-",
+               output ? ShapeString(output).c_str() : "-", mean_us,
+               ops_us > 0 ? mean_us / ops_us * 100 : 0);
+        if (flops > 0 && mean_us > 0) {
+            printf(" %9.2f %8.2f\n", flops / 1e6, flops / mean_us / 1e3);
+        } else {
+            printf(" %9s %8s\n", "-", "-");
+        }
+
+        OpStats& stats = by_type[op];
+        stats.total_us += mean_us;
+        stats.flops += flops;
+        stats.count++;
+    }
+
+    std::vector<std::pair<std::string, OpStats>> types(by_type.begin(),
+                                                       by_type.end());
+    std::sort(types.begin(), types.end(),
+              [](const std::pair<std::string, OpStats>& a,
+                 const std::pair<std::string, OpStats>& b) {
+                  return a.second.total_us > b.second.total_us;
+              });
+    printf("\n%-20s %5s %9s %6s %9s %8s\n", "op", "count", "mean(us)",
+           "share", "MFLOP", "GFLOP/s");
+    for (auto& type : types) {
+        const OpStats& stats = type.second;
+        printf("%-20s %5d %9.1f %5.1f%%", type.first.c_str(), stats.count,
+               stats.total_us,
+               ops_us > 0 ? stats.total_us / ops_us * 100 : 0);
+        if (stats.flops > 0 && stats.total_us > 0) {
+            printf(" %9.2f %8.2f\n", stats.flops / 1e6,
+                   stats.flops / stats.total_us / 1e3);
+        } else {
+            printf(" %9s %8s\n", "-", "-");
+        }
+    }
+    printf("total %.2f MFLOP, %.2f GFLOP/s\n\n", total_flops / 1e6,
+           ops_us > 0 ? total_flops / ops_us / 1e3 : 0);
+}
+
+int main(int argc, char* argv[]) {
+    int runs = 100;
+    int warmup = 10;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:w:t:")) != -1) {
+        switch (opt) {
+            case 'n':
+                runs = atoi(optarg);
+                break;
+            case 'w':
+                warmup = atoi(optarg);
+                break;
+            case 't':
+                NNTFLite::ShareCpuBackend(atoi(optarg));
+                break;
+            default:
+                optind = argc;
+                runs = 0;
+                break;
+        }
+    }
+    if (optind >= argc || runs <= 0) {
+        std::cout << "usage: " << argv[0]
+                  << " [-n runs] [-w warmup] [-t threads] model.tflite..."
+                  << std::endl;
+        return -1;
+    }
+    for (int i = optind; i < argc; i++) {
+        Profile(argv[i], runs, warmup);
+    }
+    return 0;
+}
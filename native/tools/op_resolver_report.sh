@@ -0,0 +1,30 @@
+#!/bin/bash
+# builds face_detector.elf and first_inference_bench.elf against the full
+# BuiltinOpResolver and against the generated minimal resolver, then
+# compares the stripped size of face_detector.elf, the binary that ships,
+# and the time to first inference on every model in MODEL_DIR. the time is
+# taken with first_inference_bench.elf, as face_detector.elf needs a camera
+# and a display; both link the same resolver and tflite objects
+#
+# usage: tools/op_resolver_report.sh [model_dir]
+set -e
+cd "$(dirname "$0")/.."
+MODEL_DIR=${1:-../model}
+
+build() {
+    make clean >/dev/null 2>&1 || true
+    make MINIMAL_OPS=$1 face_detector.elf first_inference_bench.elf >/dev/null
+    strip -o /tmp/face_detector_$2.elf face_detector.elf
+    strip -o /tmp/first_inference_$2.elf first_inference_bench.elf
+}
+
+build 0 builtin
+build 1 minimal
+make clean >/dev/null 2>&1 || true
+
+for variant in builtin minimal; do
+    echo "== $variant: face_detector.elf" \
+        "$(stat -c %s /tmp/face_detector_$variant.elf) bytes stripped"
+    LD_LIBRARY_PATH=inu/lib /tmp/first_inference_$variant.elf \
+        ${MODEL_DIR}/*.tflite
+done
@@ -0,0 +1,61 @@
+// records the Inu sensor's BGR and registered depth frames, paired by
+// their capture timestamps (VideoCapture::ReadRGBDFrame), into a .rgbd
+// file (see recording.h) for replay through OpenFrameSource /
+// RecordingReader
+//
+// usage: rgbd_recorder.elf output.rgbd [num_frames]
+#include "../recording.h"
+#include "../video_capture.h"
+
+// 3 s of the sensor's 30 FPS without a single depth match, e.g. the depth
+// stream stopped, ends the recording
+const int kMaxConsecutiveUnpaired = 90;
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cout << "usage: " << argv[0] << " output.rgbd [num_frames]"
+                  << std::endl;
+        return -1;
+    }
+    int num_frames = argc > 2 ? atoi(argv[2]) : 300;
+    VideoCapture capture;
+    if (!capture.IsOpened()) {
+        return -1;
+    }
+    RecordingWriter writer(argv[1]);
+    if (!writer.IsOpened()) {
+        return -1;
+    }
+    int unpaired = 0;
+    int consecutive_unpaired = 0;
+    for (int i = 0; i < num_frames;) {
+        shared_ptr<const RGBDFrame> frame = capture.ReadRGBDFrame();
+        if (frame && frame->depth.empty()) {
+            // no depth frame close enough in time, don't record a
+            // mismatched pair
+            unpaired++;
+            if (++consecutive_unpaired == kMaxConsecutiveUnpaired) {
+                std::cout << "no depth matched the last "
+                          << kMaxConsecutiveUnpaired
+                          << " frames, stopped after " << i << " frames"
+                          << std::endl;
+                break;
+            }
+            continue;
+        }
+        consecutive_unpaired = 0;
+        if (!frame || !writer.Write(frame->bgr, frame->depth,
+                                    frame->bgr_timestamp,
+                                    frame->depth_timestamp)) {
+            std::cout << "stopped after " << i << " frames" << std::endl;
+            break;
+        }
+        i++;
+    }
+    if (unpaired) {
+        std::cout << unpaired << " frames without matching depth skipped"
+                  << std::endl;
+    }
+    writer.Close();
+    return 0;
+}
@@ -0,0 +1,83 @@
+// the native half of the topic codec round trip, see
+// python/tools/check_topic_codec.py: reads messages encoded by
+// python/message_broker/codec.py from stdin, reads each with TopicReader,
+// writes what it read again with TopicWriter and sends that to stdout, for
+// codec.py to decode and compare with what it encoded.
+//
+// every message either way is a native uint32 length and the bytes, a
+// length of 0 going out means the message didn't parse
+//
+// usage: topic_codec_check.elf < messages > messages
+#include <cstdio>
+
+#include "../topic_codec.h"
+
+// the message the reader holds, encoded again. false if it has no payload
+// the writer knows
+static bool Rewrite(const TopicReader &reader, TopicWriter *writer) {
+    FaceBox box;
+    RoiImage roi;
+    cv::Mat values;
+    std::string text;
+    FrameRingRef ref;
+    switch (reader.Type()) {
+        case TopicPayload::kBox:
+            reader.GetBox(&box);
+            writer->WriteBox(box);
+            return true;
+        case TopicPayload::kRoiImage:
+            if (!reader.GetRoiImage(&roi)) {
+                return false;
+            }
+            writer->WriteRoiImage(roi);
+            return true;
+        case TopicPayload::kLandmarks:
+        case TopicPayload::kIntLandmarks:
+            if (!reader.GetLandmarks(&values)) {
+                return false;
+            }
+            writer->WriteLandmarks(values);
+            return true;
+        case TopicPayload::kGesture:
+            reader.GetGesture(&text);
+            writer->WriteGesture(text);
+            return true;
+        case TopicPayload::kEmbedding: {
+            reader.GetEmbedding(&values, &text);
+            const float *data = (const float *)values.data;
+            writer->WriteEmbedding(
+                std::vector<float>(data, data + values.total()), text);
+            return true;
+        }
+        case TopicPayload::kFrameRef:
+            reader.GetFrameRef(&text, &ref);
+            writer->WriteFrameRef(text, ref);
+            return true;
+        default:
+            return false;
+    }
+}
+
+int main() {
+    TopicReader reader;
+    TopicWriter writer;
+    std::vector<char> message;
+    uint32_t size;
+    while (fread(&size, sizeof(size), 1, stdin) == 1) {
+        message.resize(size);
+        if (size && fread(message.data(), size, 1, stdin) != 1) {
+            // stdout carries the messages
+            fprintf(stderr, "truncated message\n");
+            return -1;
+        }
+        uint32_t out_size = 0;
+        if (reader.Parse(message.data(), size) && Rewrite(reader, &writer)) {
+            out_size = writer.Size();
+        }
+        fwrite(&out_size, sizeof(out_size), 1, stdout);
+        if (out_size) {
+            fwrite(writer.Data(), out_size, 1, stdout);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,318 @@
+#include "topic_codec.h"
+
+#include <cstring>
+
+using flatbuffers::Offset;
+using flatbuffers::String;
+using flatbuffers::Table;
+using flatbuffers::Vector;
+using flatbuffers::Verifier;
+
+// the vtable slot of the field with the id in topics.fbs, what flatc would
+// generate as VT_<NAME>
+static constexpr flatbuffers::voffset_t Field(int id) { return 4 + 2 * id; }
+
+void TopicWriter::Finish(TopicPayload type, flatbuffers::uoffset_t payload) {
+    flatbuffers::uoffset_t start = this->builder.StartTable();
+    this->builder.AddOffset(Field(1), Offset<void>(payload));
+    this->builder.AddElement<uint8_t>(Field(0), (uint8_t)type, 0);
+    this->builder.Finish(Offset<void>(this->builder.EndTable(start)),
+                         kTopicIdentifier);
+}
+
+void TopicWriter::WriteBox(const FaceBox &box) {
+    this->builder.Clear();
+    auto keypoints = this->builder.CreateVector(
+        &box.keypoints[0][0], sizeof(box.keypoints) / sizeof(int));
+    flatbuffers::uoffset_t start = this->builder.StartTable();
+    this->builder.AddOffset(Field(5), keypoints);
+    this->builder.AddElement<int32_t>(Field(4), box.h, 0);
+    this->builder.AddElement<int32_t>(Field(3), box.w, 0);
+    this->builder.AddElement<int32_t>(Field(2), box.y_min, 0);
+    this->builder.AddElement<int32_t>(Field(1), box.x_min, 0);
+    this->builder.AddElement<float>(Field(0), box.score, 0);
+    Finish(TopicPayload::kBox, this->builder.EndTable(start));
+}
+
+void TopicWriter::WriteRoiImage(const RoiImage &roi) {
+    this->builder.Clear();
+    const cv::Mat &image = roi.image;
+    size_t row_size = image.cols * image.elemSize();
+    uint8_t *pixels_data;
+    auto pixels =
+        this->builder.CreateUninitializedVector(image.rows * row_size,
+                                                &pixels_data);
+    for (int y = 0; y < image.rows; y++) {
+        memcpy(pixels_data + y * row_size, image.ptr(y), row_size);
+    }
+    auto mat = this->builder.CreateVector(&roi.mat[0][0], 9);
+    flatbuffers::uoffset_t start = this->builder.StartTable();
+    this->builder.AddOffset(Field(4), mat);
+    this->builder.AddOffset(Field(3), pixels);
+    this->builder.AddElement<int32_t>(Field(1), image.cols, 0);
+    this->builder.AddElement<int32_t>(Field(0), image.rows, 0);
+    this->builder.AddElement<uint8_t>(Field(2), image.channels(), 0);
+    Finish(TopicPayload::kRoiImage, this->builder.EndTable(start));
+}
+
+void TopicWriter::WriteLandmarks(const cv::Mat &points) {
+    this->builder.Clear();
+    std::vector<uint32_t> shape(points.size.p, points.size.p + points.dims);
+    if (points.channels() > 1) {
+        shape.push_back(points.channels());
+    }
+    cv::Mat continuous = points.isContinuous() ? points : points.clone();
+    size_t count = continuous.total() * points.channels();
+    bool integer = points.depth() == CV_32S;
+    flatbuffers::uoffset_t values;
+    if (integer) {
+        values = this->builder
+                     .CreateVector((const int32_t *)continuous.data, count)
+                     .o;
+    } else {
+        values =
+            this->builder.CreateVector((const float *)continuous.data, count)
+                .o;
+    }
+    auto shape_offset = this->builder.CreateVector(shape);
+    flatbuffers::uoffset_t start = this->builder.StartTable();
+    this->builder.AddOffset(Field(1), Offset<void>(values));
+    this->builder.AddOffset(Field(0), shape_offset);
+    Finish(integer ? TopicPayload::kIntLandmarks : TopicPayload::kLandmarks,
+           this->builder.EndTable(start));
+}
+
+void TopicWriter::WriteGesture(const std::string &name) {
+    this->builder.Clear();
+    auto name_offset = this->builder.CreateString(name);
+    flatbuffers::uoffset_t start = this->builder.StartTable();
+    this->builder.AddOffset(Field(0), name_offset);
+    Finish(TopicPayload::kGesture, this->builder.EndTable(start));
+}
+
+void TopicWriter::WriteEmbedding(const std::vector<float> &values,
+                                 const std::string &label) {
+    this->builder.Clear();
+    auto values_offset = this->builder.CreateVector(values);
+    auto label_offset = this->builder.CreateString(label);
+    flatbuffers::uoffset_t start = this->builder.StartTable();
+    this->builder.AddOffset(Field(1), label_offset);
+    this->builder.AddOffset(Field(0), values_offset);
+    Finish(TopicPayload::kEmbedding, this->builder.EndTable(start));
+}
+
+void TopicWriter::WriteFrameRef(const std::string &ring,
+                                const FrameRingRef &ref) {
+    this->builder.Clear();
+    auto ring_offset = this->builder.CreateString(ring);
+    flatbuffers::uoffset_t start = this->builder.StartTable();
+    this->builder.AddElement<uint64_t>(Field(3), ref.seq, 0);
+    this->builder.AddElement<uint64_t>(Field(1), ref.instance, 0);
+    this->builder.AddOffset(Field(0), ring_offset);
+    this->builder.AddElement<uint32_t>(Field(2), ref.slot, 0);
+    Finish(TopicPayload::kFrameRef, this->builder.EndTable(start));
+}
+
+template <typename T>
+static const Vector<T> *GetVector(const Table *table, int id) {
+    return table->GetPointer<const Vector<T> *>(Field(id));
+}
+
+static const String *GetString(const Table *table, int id) {
+    return table->GetPointer<const String *>(Field(id));
+}
+
+template <typename T>
+static bool VerifyVector(const Table *table, Verifier &verifier, int id) {
+    return table->VerifyOffset(verifier, Field(id)) &&
+           verifier.VerifyVector(GetVector<T>(table, id));
+}
+
+static bool VerifyString(const Table *table, Verifier &verifier, int id) {
+    return table->VerifyOffset(verifier, Field(id)) &&
+           verifier.VerifyString(GetString(table, id));
+}
+
+// what flatc would generate as <Table>::Verify
+static bool VerifyPayload(const Table *table, TopicPayload type,
+                          Verifier &verifier) {
+    if (!table->VerifyTableStart(verifier)) {
+        return false;
+    }
+    bool ok = false;
+    switch (type) {
+        case TopicPayload::kBox:
+            ok = table->VerifyField<float>(verifier, Field(0)) &&
+                 table->VerifyField<int32_t>(verifier, Field(1)) &&
+                 table->VerifyField<int32_t>(verifier, Field(2)) &&
+                 table->VerifyField<int32_t>(verifier, Field(3)) &&
+                 table->VerifyField<int32_t>(verifier, Field(4)) &&
+                 VerifyVector<int32_t>(table, verifier, 5);
+            break;
+        case TopicPayload::kRoiImage:
+            ok = table->VerifyField<int32_t>(verifier, Field(0)) &&
+                 table->VerifyField<int32_t>(verifier, Field(1)) &&
+                 table->VerifyField<uint8_t>(verifier, Field(2)) &&
+                 VerifyVector<uint8_t>(table, verifier, 3) &&
+                 VerifyVector<double>(table, verifier, 4);
+            break;
+        case TopicPayload::kLandmarks:
+            ok = VerifyVector<uint32_t>(table, verifier, 0) &&
+                 VerifyVector<float>(table, verifier, 1);
+            break;
+        case TopicPayload::kIntLandmarks:
+            ok = VerifyVector<uint32_t>(table, verifier, 0) &&
+                 VerifyVector<int32_t>(table, verifier, 1);
+            break;
+        case TopicPayload::kGesture:
+            ok = VerifyString(table, verifier, 0);
+            break;
+        case TopicPayload::kEmbedding:
+            ok = VerifyVector<float>(table, verifier, 0) &&
+                 VerifyString(table, verifier, 1);
+            break;
+        case TopicPayload::kFrameRef:
+            ok = VerifyString(table, verifier, 0) &&
+                 table->VerifyField<uint64_t>(verifier, Field(1)) &&
+                 table->VerifyField<uint32_t>(verifier, Field(2)) &&
+                 table->VerifyField<uint64_t>(verifier, Field(3));
+            break;
+        default:
+            // a payload type newer than this build
+            break;
+    }
+    return ok && verifier.EndTable();
+}
+
+bool TopicReader::Parse(const void *data, size_t size) {
+    this->payload = nullptr;
+    this->type = TopicPayload::kNone;
+    const uint8_t *buf = (const uint8_t *)data;
+    if (size < 2 * sizeof(flatbuffers::uoffset_t) ||
+        !flatbuffers::BufferHasIdentifier(buf, kTopicIdentifier)) {
+        return false;
+    }
+    if ((uintptr_t)buf % sizeof(uint64_t) != 0) {
+        // zmq keeps small messages inside the zmq_msg_t, unaligned
+        this->aligned.resize((size + sizeof(uint64_t) - 1) / sizeof(uint64_t));
+        memcpy(this->aligned.data(), buf, size);
+        buf = (const uint8_t *)this->aligned.data();
+    }
+    Verifier verifier(buf, size);
+    const Table *message = flatbuffers::GetRoot<Table>(buf);
+    if (!verifier.VerifyOffset(0) || !message->VerifyTableStart(verifier) ||
+        !message->VerifyField<uint8_t>(verifier, Field(0)) ||
+        !message->VerifyOffsetRequired(verifier, Field(1))) {
+        return false;
+    }
+    TopicPayload type = (TopicPayload)message->GetField<uint8_t>(Field(0), 0);
+    const Table *payload = message->GetPointer<const Table *>(Field(1));
+    if (!VerifyPayload(payload, type, verifier) || !verifier.EndTable()) {
+        return false;
+    }
+    this->payload = payload;
+    this->type = type;
+    return true;
+}
+
+bool TopicReader::GetBox(FaceBox *box) const {
+    if (this->type != TopicPayload::kBox) {
+        return false;
+    }
+    const Table *table = this->payload;
+    box->score = table->GetField<float>(Field(0), 0);
+    box->x_min = table->GetField<int32_t>(Field(1), 0);
+    box->y_min = table->GetField<int32_t>(Field(2), 0);
+    box->w = table->GetField<int32_t>(Field(3), 0);
+    box->h = table->GetField<int32_t>(Field(4), 0);
+    const Vector<int32_t> *keypoints = GetVector<int32_t>(table, 5);
+    int *out = &box->keypoints[0][0];
+    size_t count = sizeof(box->keypoints) / sizeof(int);
+    for (size_t i = 0; i < count; i++) {
+        out[i] = keypoints && i < keypoints->size() ? keypoints->Get(i) : 0;
+    }
+    return true;
+}
+
+bool TopicReader::GetRoiImage(RoiImage *roi) const {
+    if (this->type != TopicPayload::kRoiImage) {
+        return false;
+    }
+    const Table *table = this->payload;
+    int height = table->GetField<int32_t>(Field(0), 0);
+    int width = table->GetField<int32_t>(Field(1), 0);
+    int channels = table->GetField<uint8_t>(Field(2), 0);
+    const Vector<uint8_t> *pixels = GetVector<uint8_t>(table, 3);
+    const Vector<double> *mat = GetVector<double>(table, 4);
+    if (height < 0 || width < 0 || channels < 1 || channels > 4 || !pixels ||
+        pixels->size() != (size_t)height * width * channels || !mat ||
+        mat->size() != 9) {
+        return false;
+    }
+    roi->image = cv::Mat(height, width, CV_8UC(channels),
+                         (void *)pixels->data());
+    for (int i = 0; i < 9; i++) {
+        roi->mat[i / 3][i % 3] = mat->Get(i);
+    }
+    return true;
+}
+
+bool TopicReader::GetLandmarks(cv::Mat *points) const {
+    bool integer = this->type == TopicPayload::kIntLandmarks;
+    if (this->type != TopicPayload::kLandmarks && !integer) {
+        return false;
+    }
+    const Vector<uint32_t> *shape = GetVector<uint32_t>(this->payload, 0);
+    // the 4 byte values of either, read by their type below
+    const Vector<float> *values = GetVector<float>(this->payload, 1);
+    if (!shape || !values || shape->size() == 0 || shape->size() > 8) {
+        return false;
+    }
+    // a single dimension is a row
+    std::vector<int> sizes(shape->size() == 1 ? 1 : 0, 1);
+    size_t total = 1;
+    for (uint32_t size : *shape) {
+        sizes.push_back(size);
+        total *= size;
+    }
+    if (total != values->size()) {
+        return false;
+    }
+    *points = cv::Mat(sizes.size(), sizes.data(), integer ? CV_32S : CV_32F,
+                      (void *)values->data());
+    return true;
+}
+
+bool TopicReader::GetGesture(std::string *name) const {
+    if (this->type != TopicPayload::kGesture) {
+        return false;
+    }
+    const String *str = GetString(this->payload, 0);
+    name->assign(str ? str->str() : "");
+    return true;
+}
+
+bool TopicReader::GetEmbedding(cv::Mat *values, std::string *label) const {
+    if (this->type != TopicPayload::kEmbedding) {
+        return false;
+    }
+    const Vector<float> *vector = GetVector<float>(this->payload, 0);
+    const String *str = GetString(this->payload, 1);
+    *values = vector ? cv::Mat(1, vector->size(), CV_32F,
+                               (void *)vector->data())
+                     : cv::Mat();
+    label->assign(str ? str->str() : "");
+    return true;
+}
+
+bool TopicReader::GetFrameRef(std::string *ring, FrameRingRef *ref) const {
+    if (this->type != TopicPayload::kFrameRef) {
+        return false;
+    }
+    const String *str = GetString(this->payload, 0);
+    ring->assign(str ? str->str() : "");
+    ref->instance = this->payload->GetField<uint64_t>(Field(1), 0);
+    ref->slot = this->payload->GetField<uint32_t>(Field(2), 0);
+    ref->seq = this->payload->GetField<uint64_t>(Field(3), 0);
+    return true;
+}
@@ -0,0 +1,83 @@
+// 2026-10-17 23:55
+#ifndef TOPIC_CODEC_H
+#define TOPIC_CODEC_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "face_payloads.h"
+#include "flatbuffers/flatbuffers.h"
+#include "frame_ring.h"
+
+// the topic payloads of topics.fbs, encoded and read through the FlatBuffers
+// runtime (there is no flatc in the build): the native stages publish and
+// consume topics of the Python apps, python/message_broker/codec.py is the
+// other side. a message is a Message table, anything on the bus without its
+// identifier is a pickle and not for us.
+
+const char kTopicIdentifier[] = "INUT";
+
+// the Payload union of topics.fbs
+enum class TopicPayload : uint8_t {
+    kNone = 0,
+    kBox = 1,
+    kRoiImage = 2,
+    kLandmarks = 3,
+    kGesture = 4,
+    kEmbedding = 5,
+    kFrameRef = 6,
+    kIntLandmarks = 7,
+};
+
+// a message at a time, the builder's memory is reused by the next one
+class TopicWriter {
+   private:
+    flatbuffers::FlatBufferBuilder builder;
+    void Finish(TopicPayload type, flatbuffers::uoffset_t payload);
+
+   public:
+    TopicWriter() : builder(1024) {}
+    void WriteBox(const FaceBox &box);
+    // 8U images of 1 to 4 channels, rows may be padded
+    void WriteRoiImage(const RoiImage &roi);
+    // CV_32F as Landmarks, CV_32S as IntLandmarks. its dimensions and
+    // channels (if more than 1) are the shape
+    void WriteLandmarks(const cv::Mat &points);
+    void WriteGesture(const std::string &name);
+    void WriteEmbedding(const std::vector<float> &values,
+                        const std::string &label);
+    void WriteFrameRef(const std::string &ring, const FrameRingRef &ref);
+    // the last message, valid until the next Write
+    const uint8_t *Data() const { return this->builder.GetBufferPointer(); }
+    size_t Size() const { return this->builder.GetSize(); }
+};
+
+// reads a message in place: the Mats it hands out point into the buffer,
+// which must outlive them. a misaligned buffer is copied first, into the
+// reader, which then must outlive them
+class TopicReader {
+   private:
+    // a copy of a misaligned buffer
+    std::vector<uint64_t> aligned;
+    const flatbuffers::Table *payload;
+    TopicPayload type;
+
+   public:
+    TopicReader() : payload(nullptr), type(TopicPayload::kNone) {}
+    // false if data is no valid message, a pickle or corrupted
+    bool Parse(const void *data, size_t size);
+    TopicPayload Type() const { return this->type; }
+    // false if the message is of another type
+    bool GetBox(FaceBox *box) const;
+    bool GetRoiImage(RoiImage *roi) const;
+    // Landmarks as CV_32FC1, IntLandmarks as CV_32SC1 of the shape (a 1-D
+    // one as a 1 x n row), values read only
+    bool GetLandmarks(cv::Mat *points) const;
+    bool GetGesture(std::string *name) const;
+    // 1 x n CV_32FC1, values read only
+    bool GetEmbedding(cv::Mat *values, std::string *label) const;
+    bool GetFrameRef(std::string *ring, FrameRingRef *ref) const;
+};
+
+#endif  // TOPIC_CODEC_H
@@ -0,0 +1,155 @@
+#include "trace.h"
+
+#ifdef TRACE_ENABLED
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+namespace {
+struct ThreadBuffer {
+    int tid;
+    int64_t frame_id;
+    // total number of events recorded, the slot of the next one is
+    // count % kTraceRingSize
+    std::atomic<uint64_t> count;
+    TraceEvent events[kTraceRingSize];
+};
+
+// the buffer of a finished thread goes to the free list and is recycled
+// by the next new thread, so there are only as many buffers as threads
+// alive at once. the events of a finished thread stay dumpable until then
+struct TraceRegistry {
+    std::mutex mutex;
+    std::vector<ThreadBuffer *> buffers;
+    std::vector<ThreadBuffer *> free_buffers;
+};
+
+void DumpAtExit() {
+    const char *path = getenv("TRACE_FILE");
+    if (path && *path) {
+        Tracer::Dump(path);
+    }
+}
+
+TraceRegistry &GetRegistry() {
+    static TraceRegistry *registry = [] {
+        atexit(DumpAtExit);
+        return new TraceRegistry();
+    }();
+    return *registry;
+}
+
+// trivially destructible, so still readable while the thread exits
+thread_local ThreadBuffer *thread_buffer = nullptr;
+thread_local bool thread_exited = false;
+
+// returns the buffer of the thread to the free list when it exits
+struct BufferRelease {
+    ~BufferRelease() {
+        TraceRegistry &registry = GetRegistry();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.free_buffers.push_back(thread_buffer);
+        thread_buffer = nullptr;
+        thread_exited = true;
+    }
+};
+
+ThreadBuffer *AcquireThreadBuffer() {
+    TraceRegistry &registry = GetRegistry();
+    ThreadBuffer *buffer;
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        if (registry.free_buffers.empty()) {
+            buffer = new ThreadBuffer();
+            registry.buffers.push_back(buffer);
+        } else {
+            // drops the events of the thread that had it
+            buffer = registry.free_buffers.back();
+            registry.free_buffers.pop_back();
+        }
+        buffer->tid = syscall(SYS_gettid);
+        buffer->frame_id = -1;
+        buffer->count = 0;
+    }
+    thread_local BufferRelease release;
+    return buffer;
+}
+
+// null once the thread is exiting, what it records then is dropped
+ThreadBuffer *GetThreadBuffer() {
+    if (!thread_buffer && !thread_exited) {
+        thread_buffer = AcquireThreadBuffer();
+    }
+    return thread_buffer;
+}
+}  // namespace
+
+void Tracer::SetFrameId(int64_t frame_id) {
+    ThreadBuffer *buffer = GetThreadBuffer();
+    if (buffer) {
+        buffer->frame_id = frame_id;
+    }
+}
+
+void Tracer::Record(const char *name, int64_t start_ns, int64_t end_ns) {
+    ThreadBuffer *buffer = GetThreadBuffer();
+    if (!buffer) {
+        return;
+    }
+    uint64_t count = buffer->count.load(std::memory_order_relaxed);
+    buffer->events[count % kTraceRingSize] =
+        TraceEvent{name, start_ns, end_ns, buffer->frame_id};
+    buffer->count.store(count + 1, std::memory_order_release);
+}
+
+int64_t Tracer::NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+// the threads keep recording while this runs, an event overwritten during
+// the dump may show up torn; dump from a quiet point for an exact trace
+bool Tracer::Dump(const std::string &path) {
+    FILE *fp = fopen(path.c_str(), "w");
+    if (!fp) {
+        return false;
+    }
+    TraceRegistry &registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    int pid = getpid();
+    const char *separator = "";
+    fprintf(fp, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (ThreadBuffer *buffer : registry.buffers) {
+        uint64_t count = buffer->count.load(std::memory_order_acquire);
+        uint64_t first = count > kTraceRingSize ? count - kTraceRingSize : 0;
+        for (uint64_t i = first; i < count; i++) {
+            const TraceEvent &event = buffer->events[i % kTraceRingSize];
+            fprintf(fp,
+                    "%s{\"name\": \"%s\", \"ph\": \"X\", \"ts\": %.3f, "
+                    "\"dur\": %.3f, \"pid\": %d, \"tid\": %d, "
+                    "\"args\": {\"frame\": %lld}}",
+                    separator, event.name, event.start_ns / 1000.0,
+                    (event.end_ns - event.start_ns) / 1000.0, pid,
+                    buffer->tid, (long long)event.frame_id);
+            separator = ",\n";
+        }
+    }
+    fprintf(fp, "\n]}\n");
+    return fclose(fp) == 0;
+}
+#else
+void Tracer::SetFrameId(int64_t frame_id) {}
+
+void Tracer::Record(const char *name, int64_t start_ns, int64_t end_ns) {}
+
+int64_t Tracer::NowNs() { return 0; }
+
+bool Tracer::Dump(const std::string &path) { return false; }
+#endif
@@ -0,0 +1,66 @@
+// 2026-10-17 14:20
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <string>
+
+// scoped tracing of the hot path. TRACE_SCOPE("name") records the start and
+// end (steady clock, ns) of the enclosing scope together with the thread
+// and the current frame id into a ring buffer owned by the calling thread,
+// so recording takes no lock and, after the first event of a thread, never
+// allocates. a scope costs about two steady_clock reads. Tracer::Dump
+// writes the last kTraceRingSize events of every thread as Chrome
+// trace_event JSON (chrome://tracing, ui.perfetto.dev); with $TRACE_FILE
+// set this also happens at exit. the buffer of a finished thread is reused
+// by the next thread started, its events are kept until then.
+//
+// without TRACE_ENABLED (make TRACE=0) the macros expand to nothing and
+// Dump is a no-op.
+
+// events kept per thread, older ones are overwritten
+const int kTraceRingSize = 1 << 14;
+
+struct TraceEvent {
+    // must outlive the tracer, i.e. a string literal
+    const char *name;
+    int64_t start_ns;
+    int64_t end_ns;
+    int64_t frame_id;
+};
+
+class Tracer {
+   public:
+    // tags the events recorded afterwards on the calling thread
+    static void SetFrameId(int64_t frame_id);
+    static void Record(const char *name, int64_t start_ns, int64_t end_ns);
+    static int64_t NowNs();
+    // returns false if the file can't be written or tracing is compiled out
+    static bool Dump(const std::string &path);
+};
+
+#ifdef TRACE_ENABLED
+class ScopedTrace {
+   private:
+    const char *name;
+    int64_t start_ns;
+
+   public:
+    explicit ScopedTrace(const char *name)
+        : name(name), start_ns(Tracer::NowNs()) {}
+    ~ScopedTrace() {
+        Tracer::Record(this->name, this->start_ns, Tracer::NowNs());
+    }
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) \
+    ScopedTrace TRACE_CONCAT(trace_scope_, __LINE__)(name)
+#define TRACE_FRAME(frame_id) Tracer::SetFrameId(frame_id)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_FRAME(frame_id)
+#endif
+
+#endif  // TRACE_H
@@ -1,6 +1,10 @@
 #include "util.h"
+
+#include "trace.h"
+
 ResizedImage ResizeAndKeepAspectRatio(cv::Mat img, int roi_width,
                                       int roi_height) {
+    TRACE_SCOPE("ResizeAndKeepAspectRatio");
     int height = img.rows;
     int width = img.cols;
     float orig_aspect_ratio = (float)height / width;
@@ -19,13 +23,15 @@ ResizedImage ResizeAndKeepAspectRatio(cv::Mat img, int roi_width,
         h_padding = roi_width - new_width;
     }
     cv::resize(img, img, cv::Size(new_width, new_height));
-    v_padding /= 2;
-    h_padding /= 2;
-    cv::copyMakeBorder(img, img, v_padding, v_padding, h_padding, h_padding,
+    // odd paddings put the extra row/col at the bottom/right so that the
+    // output is always exactly roi_width x roi_height
+    int top = v_padding / 2;
+    int left = h_padding / 2;
+    cv::copyMakeBorder(img, img, top, v_padding - top, left, h_padding - left,
                        cv::BORDER_CONSTANT, cv::Scalar(0, 0, 0));
     return ResizedImage{
         img,
-        (float)v_padding / roi_width,
-        (float)h_padding / roi_height,
+        (float)top / roi_height,
+        (float)left / roi_width,
     };
 }
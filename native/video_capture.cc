@@ -3,6 +3,9 @@
 
 #include "video_capture.h"
 
+#include "preprocess.h"
+#include "trace.h"
+
 #define kInuWebcamStream 9
 #define kInuDepthStream 5
 
@@ -91,22 +94,135 @@ bool VideoCapture::init() {
     return (true);
 }
 
-VideoCapture::VideoCapture() {
-    if (!init()) {
-        exit(-1);
+VideoCapture::VideoCapture(bool async, bool flip, bool rgb)
+    : opened(false),
+      async(async),
+      flip(flip),
+      rgb(rgb),
+      pool_index(0),
+      num_read(0),
+      total_latency_ms(0),
+      max_latency_ms(0),
+      rgbd_index(0) {
+    this->opened = init();
+    if (!this->opened) {
+        std::cout << "No Inu device available" << std::endl;
+        return;
     }
     this->webcam_stream->GetFrame(this->image_frame);
     this->depth_stream->GetFrame(this->depth_frame);
+    if (!this->async) {
+        return;
+    }
+    // called on the SDK's threads, Post never blocks them
+    this->webcam_stream->Register(
+        [this](shared_ptr<CImageStream>, shared_ptr<const CImageFrame> frame,
+               CInuError err) {
+            if (err != eOK || !frame || !frame->Valid) {
+                return;
+            }
+            this->image_mailbox.Post(frame);
+            this->fresh_image.notify_one();
+        });
+    this->depth_stream->Register(
+        [this](shared_ptr<CDepthStream>, shared_ptr<const CImageFrame> frame,
+               CInuError err) {
+            if (err != eOK || !frame || !frame->Valid) {
+                return;
+            }
+            this->depth_mailbox.Post(frame);
+            AddDepthHistory(frame);
+        });
+}
+
+bool VideoCapture::NextImageFrame() {
+    if (!this->async) {
+        this->webcam_stream->GetFrame(this->image_frame);
+        return true;
+    }
+    const shared_ptr<const CImageFrame> *frame = this->image_mailbox.Take();
+    steady_clock::time_point deadline =
+        steady_clock::now() + milliseconds(kFrameTimeoutMs);
+    while (!frame) {
+        if (steady_clock::now() >= deadline) {
+            std::cout << "No frame from the sensor for " << kFrameTimeoutMs
+                      << " ms" << std::endl;
+            return false;
+        }
+        // the notify isn't synchronized with the mutex, the timeout bounds
+        // the delay of a missed wakeup
+        std::unique_lock<std::mutex> lock(this->wait_mutex);
+        this->fresh_image.wait_for(lock, milliseconds(1), [this] {
+            return this->image_mailbox.HasFresh();
+        });
+        frame = this->image_mailbox.Take();
+    }
+    this->image_frame = *frame;
+
+    int64_t now = duration_cast<nanoseconds>(
+                      system_clock::now().time_since_epoch())
+                      .count();
+    double latency_ms = (now - (int64_t)this->image_frame->Timestamp) / 1e6;
+    this->num_read++;
+    this->total_latency_ms += latency_ms;
+    this->max_latency_ms = std::max(this->max_latency_ms, latency_ms);
+    return true;
+}
+
+CaptureStats VideoCapture::Stats() const {
+    return CaptureStats{
+        this->image_mailbox.NumPosted(),
+        this->image_mailbox.NumDropped(),
+        this->num_read,
+        this->num_read ? this->total_latency_ms / this->num_read : 0,
+        this->max_latency_ms,
+    };
+}
+
+std::string VideoCapture::Report() const {
+    if (!this->opened || !this->async) {
+        return std::string();
+    }
+    CaptureStats stats = Stats();
+    char line[160];
+    snprintf(line, sizeof(line),
+             "capture: %lu frames, %lu dropped, %lu read, latency mean "
+             "%.1f ms max %.1f ms",
+             (unsigned long)stats.posted, (unsigned long)stats.dropped,
+             (unsigned long)stats.read, stats.mean_latency_ms,
+             stats.max_latency_ms);
+    return line;
 }
 
 void VideoCapture::GetShape(int *height, int *width) {
+    if (!this->opened) {
+        *height = *width = 0;
+        return;
+    }
     *height = this->image_frame->Height();
     *width = this->image_frame->Width();
 }
 
+int64_t VideoCapture::BGRTimestamp() const {
+    return this->opened ? this->image_frame->Timestamp : 0;
+}
+
+int64_t VideoCapture::DepthTimestamp() const {
+    return this->opened ? this->depth_frame->Timestamp : 0;
+}
+
 cv::Mat VideoCapture::ReadDepthImage() {
+    if (!this->opened) {
+        return cv::Mat();
+    }
     CInuError err(eInitError);
-    this->depth_stream->GetFrame(this->depth_frame);
+    if (!this->async) {
+        this->depth_stream->GetFrame(this->depth_frame);
+    } else if (const shared_ptr<const CImageFrame> *frame =
+                   this->depth_mailbox.Take()) {
+        // otherwise the last depth frame is still the newest one
+        this->depth_frame = *frame;
+    }
     int image_width = this->depth_frame->Width();
     int image_height = this->depth_frame->Height();
 
@@ -114,50 +230,170 @@ cv::Mat VideoCapture::ReadDepthImage() {
     cv::Mat img = cv::Mat(
         image_height, image_width, CV_16U,
         (uchar *)this->depth_frame->GetData());
-    cv::flip(img, img, 2);
+    if (this->flip) {
+        // not in place, the SDK buffer may be read again (async mode,
+        // RGBDFrame)
+        cv::flip(img, this->flipped_depth, 2);
+        return this->flipped_depth;
+    }
     return img;
 }
 
 cv::Mat VideoCapture::ReadBGRImage() {
+    TRACE_SCOPE("VideoCapture::ReadBGRImage");
+    if (!this->opened) {
+        return cv::Mat();
+    }
     CInuError err(eInitError);
-    this->webcam_stream->GetFrame(this->image_frame);
-    cv::Mat img;
-
-    int image_width = this->image_frame->Width();
-    int image_height = this->image_frame->Height();
+    if (!NextImageFrame()) {
+        return cv::Mat();
+    }
+    cv::Mat &output = this->bgr_pool[this->pool_index];
+    this->pool_index = (this->pool_index + 1) % kNumPooledFrames;
+    return ConvertImage(*this->image_frame, output);
+}
 
-    switch (this->image_frame->Format()) {
+// BGR (RGB if rgb, mirrored if flip) from the frame's own format, written
+// to buffer unless it can be returned zero copy
+cv::Mat VideoCapture::ConvertImage(const CImageFrame &frame,
+                                   cv::Mat &buffer) {
+    int image_width = frame.Width();
+    int image_height = frame.Height();
+    uchar *data = (uchar *)frame.GetData();
+    PixelFormat format;
+    int type = CV_8UC3;
+    switch (frame.Format()) {
         case CImageFrame::eRGB:
-            img = cv::Mat(
-                image_height, image_width, CV_8UC3,
-                (uchar *)this->image_frame->GetData());
-            cv::cvtColor(img, img, cv::COLOR_RGB2BGR);
+            format = kPixelRGB;
             break;
         case CImageFrame::eBGR:
-            img = cv::Mat(
-                image_height, image_width, CV_8UC3,
-                (uchar *)this->image_frame->GetData());
+            format = kPixelBGR;
             break;
         case CImageFrame::eBGRA:
-            img = cv::Mat(
-                image_height, image_width, CV_8UC4,
-                (uchar *)this->image_frame->GetData());
             // TODO: inu bug? the frame format seems like RGBA instead of
             // reported BGRA
-            cv::cvtColor(img, img, cv::COLOR_RGBA2BGR);
+            format = kPixelRGBA;
+            type = CV_8UC4;
             break;
         case CImageFrame::eRGBA:
-            img = cv::Mat(
-                image_height, image_width, CV_8UC4,
-                (uchar *)this->image_frame->GetData());
-            cv::cvtColor(img, img, cv::COLOR_RGBA2RGB);
+            // keeps the byte order, like the cvtColor(RGBA2RGB) this
+            // replaced, the reported format seems swapped here as well
+            format = kPixelBGRA;
+            type = CV_8UC4;
             break;
         default:
-            printf(
-                "Got unrecognised format: %d\n", this->image_frame->Format());
-            break;
+            printf("Got unrecognised format: %d\n", frame.Format());
+            return cv::Mat();
+    }
+    if (this->rgb) {
+        // converting "to BGR" from the swapped order yields RGB
+        static const PixelFormat kSwapped[] = {kPixelBGR, kPixelRGB,
+                                               kPixelBGRA, kPixelRGBA};
+        format = kSwapped[format];
+    }
+    cv::Mat img(image_height, image_width, type, data);
+    if (format == kPixelBGR && !this->flip) {
+        return img;
+    }
+    // channel swizzle and mirroring in one pass
+    ConvertToBGR(img, format, this->flip, buffer);
+    return buffer;
+}
+
+void VideoCapture::AddDepthHistory(
+    const shared_ptr<const CImageFrame> &frame) {
+    {
+        std::lock_guard<std::mutex> lock(this->depth_mutex);
+        this->depth_history.push_back(frame);
+        if (this->depth_history.size() > kRGBDRingSize) {
+            this->depth_history.pop_front();
+        }
+    }
+    this->fresh_depth.notify_one();
+}
+
+// the depth frame closest to timestamp, nullptr if none is within
+// kRGBDSyncToleranceNs
+shared_ptr<const CImageFrame> VideoCapture::MatchDepth(int64_t timestamp) {
+    auto newest_is_late = [this, timestamp] {
+        return this->depth_history.empty() ||
+               (int64_t)this->depth_history.back()->Timestamp <
+                   timestamp - kRGBDSyncToleranceNs;
+    };
+    std::unique_lock<std::mutex> lock(this->depth_mutex);
+    if (!this->async) {
+        // the depth stream runs in lockstep with the webcam, a couple of
+        // reads catch up with the webcam frame
+        for (int i = 0; i < kRGBDRingSize && newest_is_late(); i++) {
+            shared_ptr<const CImageFrame> frame;
+            lock.unlock();
+            CInuError err = this->depth_stream->GetFrame(frame);
+            if (err != eOK || !frame) {
+                lock.lock();
+                break;
+            }
+            AddDepthHistory(frame);
+            lock.lock();
+        }
+    } else {
+        this->fresh_depth.wait_for(lock, nanoseconds(kRGBDSyncToleranceNs),
+                                   [&] { return !newest_is_late(); });
+    }
+    shared_ptr<const CImageFrame> best;
+    int64_t best_diff = kRGBDSyncToleranceNs + 1;
+    for (const shared_ptr<const CImageFrame> &frame : this->depth_history) {
+        int64_t diff = std::abs((int64_t)frame->Timestamp - timestamp);
+        if (diff < best_diff) {
+            best = frame;
+            best_diff = diff;
+        }
+    }
+    return best;
+}
+
+shared_ptr<const RGBDFrame> VideoCapture::ReadRGBDFrame() {
+    TRACE_SCOPE("VideoCapture::ReadRGBDFrame");
+    if (!this->opened) {
+        return nullptr;
+    }
+    if (!NextImageFrame()) {
+        return nullptr;
+    }
+    // reuse the slot (and its buffers) unless a caller still holds it
+    shared_ptr<RGBDFrame> &slot = this->rgbd_ring[this->rgbd_index];
+    this->rgbd_index = (this->rgbd_index + 1) % kRGBDRingSize;
+    if (!slot || slot.use_count() > 1) {
+        slot = std::make_shared<RGBDFrame>();
+    }
+    RGBDFrame &frame = *slot;
+    frame.image_frame = this->image_frame;
+    frame.bgr_timestamp = this->image_frame->Timestamp;
+    frame.bgr = ConvertImage(*this->image_frame, frame.bgr);
+
+    frame.depth_frame = MatchDepth(frame.bgr_timestamp);
+    frame.depth_timestamp = 0;
+    if (!frame.depth_frame) {
+        frame.depth.release();
+        return slot;
+    }
+    frame.depth_timestamp = frame.depth_frame->Timestamp;
+    cv::Mat depth(frame.depth_frame->Height(), frame.depth_frame->Width(),
+                  CV_16U, (uchar *)frame.depth_frame->GetData());
+    if (this->flip) {
+        cv::flip(depth, frame.depth, 2);
+    } else {
+        frame.depth = depth;
+    }
+    return slot;
+}
+
+VideoCapture::~VideoCapture() {
+    if (this->opened && this->async) {
+        // the callbacks capture this
+        this->webcam_stream->Register(nullptr);
+        this->depth_stream->Register(nullptr);
+    }
+    if (this->sensor) {
+        this->sensor->Terminate();
     }
-    cv::flip(img, img, 2);
-    return img;
 }
-VideoCapture::~VideoCapture() { this->sensor->Terminate(); }
@@ -2,10 +2,104 @@
 #ifndef VIDEO_CAPTURE_H
 #define VIDEO_CAPTURE_H
 
+#include <deque>
+
 #include "common.h"
+#include "frame_source.h"
+#include "mailbox.h"
+
+// async mode counters, the latency is from the sensor's capture timestamp
+// to the moment ReadBGRImage hands the frame out
+struct CaptureStats {
+    // frames delivered by the sensor
+    uint64_t posted;
+    // replaced by a newer frame before anyone read them
+    uint64_t dropped;
+    uint64_t read;
+    double mean_latency_ms;
+    double max_latency_ms;
+};
+
+// a BGR frame and the registered depth frame captured at the same instant
+// (sensor timestamps at most kRGBDSyncToleranceNs apart). handed out as
+// shared_ptr<const RGBDFrame>: holders keep the pair (and the SDK buffers
+// it points into) alive and consistent without copying or re-reading the
+// device
+struct RGBDFrame {
+    int64_t bgr_timestamp;
+    int64_t depth_timestamp;
+    // 8UC3, mirrored and channel ordered like ReadBGRImage
+    cv::Mat bgr;
+    // 16U registered to bgr, empty if no depth frame matched bgr_timestamp
+    cv::Mat depth;
+    shared_ptr<const CImageFrame> image_frame;
+    shared_ptr<const CImageFrame> depth_frame;
+};
+
+// half the sensor's 30 FPS frame period
+const int64_t kRGBDSyncToleranceNs = 16000000;
+// RGBDFrames recycled by ReadRGBDFrame, and depth frames kept for pairing
+const int kRGBDRingSize = 4;
+// an async read fails if no frame arrived for this long (30 frame periods),
+// e.g. the device stopped or was unplugged
+const int kFrameTimeoutMs = 1000;
+// converted frames ReadBGRImage writes into in turn
+const int kNumPooledFrames = 3;
+
+// the Inu sensor's webcam and registered depth stream, at the sensor's
+// own 30 FPS.
+//
+// by default every read calls the blocking GetFrame, i.e. waits for the
+// next sensor frame. in async mode the streams push their frames from the
+// SDK's callbacks into LatestMailbox slots and a read takes the newest
+// frame that arrived meanwhile, so capture overlaps with inference and a
+// frame is never older than the time the caller spent since its last
+// read. a read only waits if no frame arrived since the last one.
+//
+// the sensor image is mirrored (flip = true) like a webcam preview by
+// default. with flip = false (inu:noflip) the frames come out as the
+// sensor sees them, which saves the mirroring pass (and the copy for BGR
+// frames) for consumers that don't show or crop a mirrored view, e.g.
+// recordings and benchmarks. the images, and so the boxes detected on
+// them, are then unmirrored: nothing mirrors the coordinates back.
+//
+// with rgb = true every color frame (ReadBGRImage, RGBDFrame::bgr) comes
+// out in RGB order instead, for consumers like the Python pipeline that
+// work in RGB. the swap is folded into the conversion pass.
 
-class VideoCapture {
+class VideoCapture : public FrameSource {
    private:
+    bool opened;
+    bool async;
+    bool flip;
+    bool rgb;
+    // converted frames are written into these in turn, a returned Mat stays
+    // valid until kNumPooledFrames more frames were read. a BGR frame that
+    // isn't flipped is returned zero copy instead, as a view of the SDK
+    // buffer that is only valid until the next read
+    cv::Mat bgr_pool[kNumPooledFrames];
+    int pool_index;
+    LatestMailbox<shared_ptr<const CImageFrame>> image_mailbox;
+    LatestMailbox<shared_ptr<const CImageFrame>> depth_mailbox;
+    std::mutex wait_mutex;
+    std::condition_variable fresh_image;
+    uint64_t num_read;
+    double total_latency_ms;
+    double max_latency_ms;
+    // unconsumed mirrored depth of ReadDepthImage
+    cv::Mat flipped_depth;
+    // recent depth frames, oldest first, filled by ReadRGBDFrame (sync)
+    // or the depth callback (async)
+    std::deque<shared_ptr<const CImageFrame>> depth_history;
+    std::mutex depth_mutex;
+    std::condition_variable fresh_depth;
+    shared_ptr<RGBDFrame> rgbd_ring[kRGBDRingSize];
+    int rgbd_index;
+    // false if no frame came within kFrameTimeoutMs (async)
+    bool NextImageFrame();
+    cv::Mat ConvertImage(const CImageFrame &frame, cv::Mat &buffer);
+    void AddDepthHistory(const shared_ptr<const CImageFrame> &frame);
+    shared_ptr<const CImageFrame> MatchDepth(int64_t timestamp);
     shared_ptr<const CImageFrame> image_frame;
     shared_ptr<const CImageFrame> depth_frame;
     shared_ptr<CInuSensorExt> sensor;
@@ -14,11 +108,26 @@ class VideoCapture {
     bool init();
 
    public:
-    VideoCapture();
+    // without a device IsOpened() is false and every read returns an
+    // empty Mat, as does a read that timed out (see kFrameTimeoutMs)
+    explicit VideoCapture(bool async = false, bool flip = true,
+                          bool rgb = false);
     virtual ~VideoCapture();
-    cv::Mat ReadBGRImage();
-    cv::Mat ReadDepthImage();
-    void GetShape(int *height, int *width);
+    bool IsOpened() const override { return this->opened; }
+    cv::Mat ReadBGRImage() override;
+    cv::Mat ReadDepthImage() override;
+    void GetShape(int *height, int *width) override;
+    int64_t BGRTimestamp() const override;
+    int64_t DepthTimestamp() const override;
+    bool IsLive() const override { return true; }
+    // the Stats() of async mode
+    std::string Report() const override;
+    CaptureStats Stats() const;
+    // the next BGR frame (like ReadBGRImage) paired with the depth frame
+    // closest to it in time. a read waits at most kRGBDSyncToleranceNs for
+    // the matching depth frame to arrive. nullptr without a device or if
+    // the read timed out
+    shared_ptr<const RGBDFrame> ReadRGBDFrame();
 };
 
 #endif  // VIDEO_CAPTURE_H
@@ -8,6 +8,12 @@ from collections import namedtuple
 from common import util, Detector
 from message_broker import Publisher
 
+try:
+    # native decode + NMS (native/pyext/box_decoder.cc), built by `make pyext`
+    import box_decoder  # type: ignore
+except ImportError:
+    box_decoder = None
+
 BoxConfig = namedtuple(
     "BoxConfig",
     [
@@ -43,6 +49,21 @@ class Box:
             self.keypoints.append([box[4 + 2 * i], box[4 + 2 * i + 1]])
 
 
+def box_dtype(num_keypoint):
+    # one row per box, laid out like the native BasicBox. coordinates are
+    # normalized to the model input
+    return np.dtype(
+        [
+            ("score", np.float32),
+            ("xmin", np.float32),
+            ("ymin", np.float32),
+            ("width", np.float32),
+            ("height", np.float32),
+            ("keypoints", np.float32, (num_keypoint, 2)),
+        ]
+    )
+
+
 class BoxDetector(Detector):
     def __init__(self, config: BoxConfig):
         super().__init__(
@@ -56,6 +77,8 @@ class BoxDetector(Detector):
         self.config = config
         self.anchors = self._gen_anchors()
         self.publisher = Publisher()
+        self.box_dtype = box_dtype(config.num_keypoint)
+        self.decoder = self._native_decoder()
 
     def detect(self, img):
         self.img_height, self.img_width = img.shape[:2]
@@ -71,31 +94,75 @@ class BoxDetector(Detector):
         regressors, classificators = super().invoke(input_data)
 
         boxes = self._post_detect(regressors, classificators)
+        if len(boxes) == 0:
+            return []
 
+        # corners and keypoints of all boxes, restored in one go
+        num_boxes = len(boxes)
+        coord = np.empty((num_boxes, 2 + self.config.num_keypoint, 2))
+        coord[:, 0, 0] = boxes["xmin"]
+        coord[:, 0, 1] = boxes["ymin"]
+        coord[:, 1, 0] = boxes["xmin"] + boxes["width"]
+        coord[:, 1, 1] = boxes["ymin"] + boxes["height"]
+        coord[:, 2:] = boxes["keypoints"]
         rect = np.array([self.config.img_width, self.config.img_height])
-        for box in boxes:
-            # convert boxes to ndarray
-            coord = [box.xmin, box.ymin, box.xmin + box.width, box.ymin + box.height]
-            for point in box.keypoints:
-                coord.append(point[0])
-                coord.append(point[1])
-
-            coord = np.array(coord).reshape(-1, 2)
-            coord = util.restore_coords_2d(coord * rect, mat).astype("int")
-
-            # convert ndarray back to boxes
-            box.xmin = coord[0][0]
-            box.ymin = coord[0][1]
-            box.width = coord[1][0] - coord[0][0]
-            box.height = coord[1][1] - coord[0][1]
-            for i, point in enumerate(box.keypoints):
-                point[0] = coord[2 + i][0]
-                point[1] = coord[2 + i][1]
+        coord = util.restore_coords_2d(coord.reshape(-1, 2) * rect, mat)
+        coord = coord.astype("int").reshape(num_boxes, -1, 2)
 
         # 最终输出坐标是 webcam image 上的绝对坐标
-        return boxes
+        result = []
+        for score, points in zip(boxes["score"], coord):
+            (x1, y1), (x2, y2) = points[:2]
+            box = [x1, y1, x2 - x1, y2 - y1, *points[2:].flatten()]
+            result.append(Box(score, box, self.config.num_keypoint))
+        return result
+
+    def _native_decoder(self):
+        # the native specs are compiled in, only use one matching the config,
+        # thresholds included. those are float32 natively, compared as such
+        if box_decoder is None:
+            return None
+        for spec in ["face", "palm"]:
+            decoder = box_decoder.Decoder(spec)
+            if (
+                decoder.input_height,
+                decoder.input_width,
+                decoder.num_coords,
+                decoder.num_boxes,
+                decoder.num_keypoints,
+                np.float32(decoder.min_score_thresh),
+                np.float32(decoder.nms_thresh),
+            ) == (
+                self.config.img_height,
+                self.config.img_width,
+                self.config.num_coords,
+                self.config.num_boxes,
+                self.config.num_keypoint,
+                np.float32(self.config.min_score_thresh),
+                np.float32(self.config.nms_thresh),
+            ):
+                return decoder
+        return None
 
     def _post_detect(self, regressors, classificators):
+        # -> structured array of box_dtype, best box first
+        if self.decoder is not None:
+            raw = self.decoder.decode(
+                np.ascontiguousarray(regressors, dtype=np.float32),
+                np.ascontiguousarray(classificators, dtype=np.float32),
+            )
+            return np.frombuffer(raw, dtype=self.box_dtype)
+
+        boxes = self._post_detect_py(regressors, classificators)
+        array = np.zeros(len(boxes), dtype=self.box_dtype)
+        for row, box in zip(array, boxes):
+            row["score"] = box.score
+            row["xmin"], row["ymin"] = box.xmin, box.ymin
+            row["width"], row["height"] = box.width, box.height
+            row["keypoints"] = box.keypoints
+        return array
+
+    def _post_detect_py(self, regressors, classificators):
         raw_boxes = np.reshape(regressors, (-1))
         raw_scores = np.reshape(classificators, (-1))
 
@@ -2,3 +2,7 @@
 # -*- coding: utf-8 -*-
 # 2021-03-01 21:26
 FPS = 30
+# python: a ZMQ topic per stage. native: video_capture runs capture -> face
+# detection -> face_roi in one native graph (native/calculators.h) and
+# publishes the same topics, face_detection is idle
+PIPELINE = "python"
@@ -2,11 +2,15 @@
 # -*- coding: utf-8 -*-
 # 2021-02-23 10:07
 from .config import *
+from config import *
 from .face_detector import FaceDetector
 from message_broker import Subscriber
 
 
 def run():
+    if PIPELINE == "native":
+        # video_capture publishes face_box and face_roi
+        return
     Subscriber().sub([b"image"], FaceDetector()).loop()
 
 
@@ -0,0 +1,246 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# 2026-10-17 23:55
+# topic payloads as the FlatBuffers of native/topics.fbs instead of pickles,
+# the Python side of native/topic_codec.h. there is no flatc in the build:
+# the tables are written and read through the runtime by field id, keep
+# them in sync with the schema.
+#
+# decoded arrays are views into the received message, not copies.
+import sys
+from collections import namedtuple
+
+import flatbuffers
+import numpy as np
+from flatbuffers import encode as fb_encode
+from flatbuffers import number_types as N
+from flatbuffers.table import Table
+
+IDENTIFIER = b"INUT"
+
+# the Payload union of topics.fbs
+BOX, ROI_IMAGE, LANDMARKS, GESTURE, EMBEDDING, FRAME_REF, INT_LANDMARKS = range(1, 8)
+
+# what is published for an Embedding
+Embedding = namedtuple("Embedding", ["values", "label"])
+
+
+def _vt(field_id):
+    # the vtable offset of a field, what flatc generates as VT_<NAME>
+    return 4 + 2 * field_id
+
+
+def _vector(builder, array, dtype):
+    return builder.CreateNumpyVector(np.ascontiguousarray(array, dtype).ravel())
+
+
+def _encode_box(builder, box):
+    keypoints = _vector(builder, np.rint(box.keypoints), np.int32)
+    builder.StartObject(6)
+    builder.PrependFloat32Slot(0, float(box.score), 0.0)
+    for field_id, value in enumerate((box.xmin, box.ymin, box.width, box.height)):
+        # a velocity filtered one is a 1 element array
+        builder.PrependInt32Slot(field_id + 1, int(np.rint(value).item()), 0)
+    builder.PrependUOffsetTRelativeSlot(5, keypoints, 0)
+    return builder.EndObject()
+
+
+def _encode_roi_image(builder, roi):
+    image = roi.image
+    pixels = _vector(builder, image, np.uint8)
+    mat = _vector(builder, roi.mat, np.float64)
+    builder.StartObject(5)
+    builder.PrependInt32Slot(0, image.shape[0], 0)
+    builder.PrependInt32Slot(1, image.shape[1], 0)
+    builder.PrependUint8Slot(2, image.shape[2] if image.ndim == 3 else 1, 0)
+    builder.PrependUOffsetTRelativeSlot(3, pixels, 0)
+    builder.PrependUOffsetTRelativeSlot(4, mat, 0)
+    return builder.EndObject()
+
+
+def _encode_landmarks(builder, points, dtype=np.float32):
+    shape = _vector(builder, points.shape, np.uint32)
+    values = _vector(builder, points, dtype)
+    builder.StartObject(2)
+    builder.PrependUOffsetTRelativeSlot(0, shape, 0)
+    builder.PrependUOffsetTRelativeSlot(1, values, 0)
+    return builder.EndObject()
+
+
+def _encode_int_landmarks(builder, points):
+    return _encode_landmarks(builder, points, np.int32)
+
+
+def _fits_int32(array):
+    info = np.iinfo(np.int32)
+    return array.dtype.itemsize < 4 or (
+        array.min() >= info.min and array.max() <= info.max
+    )
+
+
+def _encode_gesture(builder, name):
+    name = builder.CreateString(name)
+    builder.StartObject(1)
+    builder.PrependUOffsetTRelativeSlot(0, name, 0)
+    return builder.EndObject()
+
+
+def _encode_embedding(builder, embedding):
+    values = _vector(builder, embedding.values, np.float32)
+    label = builder.CreateString(embedding.label or "")
+    builder.StartObject(2)
+    builder.PrependUOffsetTRelativeSlot(0, values, 0)
+    builder.PrependUOffsetTRelativeSlot(1, label, 0)
+    return builder.EndObject()
+
+
+def _encode_frame_ref(builder, ref):
+    ring = builder.CreateString(ref.ring)
+    builder.StartObject(4)
+    builder.PrependUOffsetTRelativeSlot(0, ring, 0)
+    builder.PrependUint64Slot(1, ref.instance, 0)
+    builder.PrependUint32Slot(2, ref.slot, 0)
+    builder.PrependUint64Slot(3, ref.seq, 0)
+    return builder.EndObject()
+
+
+def _loaded_type(module, name):
+    # data can't be of a type whose module isn't loaded, and it isn't loaded
+    # just to check: common.util pulls in tensorflow
+    return getattr(sys.modules.get(module), name, ())
+
+
+def _payload_type(data):
+    # by type, the topic doesn't matter. uint8 arrays are images and stay
+    # pickles, the other numeric ones are landmarks: float ones as float32,
+    # integer ones as int32 (pickled if their values don't fit)
+    from .transport import FrameRef
+
+    if isinstance(data, _loaded_type("box_detection.box_detector", "Box")):
+        return BOX, _encode_box
+    if isinstance(data, _loaded_type("common.util", "ROIImage")):
+        return ROI_IMAGE, _encode_roi_image
+    if isinstance(data, FrameRef):
+        return FRAME_REF, _encode_frame_ref
+    if isinstance(data, Embedding):
+        return EMBEDDING, _encode_embedding
+    if isinstance(data, str):
+        return GESTURE, _encode_gesture
+    if isinstance(data, np.ndarray) and data.dtype != np.uint8 and data.size > 0:
+        if data.dtype.kind == "f":
+            return LANDMARKS, _encode_landmarks
+        if data.dtype.kind in "iu" and _fits_int32(data):
+            return INT_LANDMARKS, _encode_int_landmarks
+    return None, None
+
+
+def encode(data):
+    """data as a Message, None if topics.fbs has no table for it"""
+    payload_type, encoder = _payload_type(data)
+    if payload_type is None:
+        return None
+    builder = flatbuffers.Builder(1024)
+    payload = encoder(builder, data)
+    builder.StartObject(2)
+    builder.PrependUOffsetTRelativeSlot(1, payload, 0)
+    builder.PrependUint8Slot(0, payload_type, 0)
+    builder.Finish(builder.EndObject(), IDENTIFIER)
+    return builder.Output()
+
+
+def is_message(buf):
+    return len(buf) >= 8 and bytes(buf[4:8]) == IDENTIFIER
+
+
+class _Reader(object):
+    def __init__(self, buf, pos):
+        self.table = Table(buf, pos)
+
+    def _offset(self, field_id):
+        return self.table.Offset(_vt(field_id))
+
+    def scalar(self, field_id, flags, default=0):
+        o = self._offset(field_id)
+        return self.table.Get(flags, self.table.Pos + o) if o else default
+
+    def array(self, field_id, flags):
+        o = self._offset(field_id)
+        if not o:
+            return np.zeros(0, N.to_numpy_type(flags))
+        return self.table.GetVectorAsNumpy(flags, o)
+
+    def string(self, field_id):
+        o = self._offset(field_id)
+        return self.table.String(self.table.Pos + o).decode() if o else ""
+
+    def table_at(self, field_id):
+        o = self._offset(field_id)
+        return _Reader(self.table.Bytes, self.table.Indirect(self.table.Pos + o))
+
+
+def _decode_box(t):
+    from box_detection.box_detector import Box
+
+    keypoints = t.array(5, N.Int32Flags).tolist()
+    coords = [t.scalar(i, N.Int32Flags) for i in range(1, 5)]
+    return Box(
+        t.scalar(0, N.Float32Flags, 0.0), coords + keypoints, len(keypoints) // 2
+    )
+
+
+def _decode_roi_image(t):
+    from common.util import ROIImage
+
+    height, width = t.scalar(0, N.Int32Flags), t.scalar(1, N.Int32Flags)
+    channels = t.scalar(2, N.Uint8Flags)
+    shape = (height, width, channels) if channels > 1 else (height, width)
+    image = t.array(3, N.Uint8Flags).reshape(shape)
+    return ROIImage(image, t.array(4, N.Float64Flags).reshape(3, 3))
+
+
+def _decode_landmarks(t, flags=N.Float32Flags):
+    return t.array(1, flags).reshape(tuple(t.array(0, N.Uint32Flags)))
+
+
+def _decode_int_landmarks(t):
+    return _decode_landmarks(t, N.Int32Flags)
+
+
+def _decode_gesture(t):
+    return t.string(0)
+
+
+def _decode_embedding(t):
+    return Embedding(t.array(0, N.Float32Flags), t.string(1))
+
+
+def _decode_frame_ref(t):
+    from .transport import FrameRef
+
+    return FrameRef(
+        t.string(0),
+        t.scalar(1, N.Uint64Flags),
+        t.scalar(2, N.Uint32Flags),
+        t.scalar(3, N.Uint64Flags),
+    )
+
+
+_DECODERS = {
+    BOX: _decode_box,
+    ROI_IMAGE: _decode_roi_image,
+    LANDMARKS: _decode_landmarks,
+    GESTURE: _decode_gesture,
+    EMBEDDING: _decode_embedding,
+    FRAME_REF: _decode_frame_ref,
+    INT_LANDMARKS: _decode_int_landmarks,
+}
+
+
+def decode(buf):
+    """the payload of a Message"""
+    message = _Reader(buf, fb_encode.Get(N.UOffsetTFlags.packer_type, buf, 0))
+    payload_type = message.scalar(0, N.Uint8Flags)
+    decoder = _DECODERS.get(payload_type)
+    if decoder is None:
+        raise ValueError("unknown payload type %d" % payload_type)
+    return decoder(message.table_at(1))
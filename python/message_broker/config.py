@@ -3,3 +3,24 @@
 # 2021-02-23 11:20
 INBOUND_ADDR = "tcp://127.0.0.1:5555"
 OUTBOUND_ADDR = "tcp://127.0.0.1:5556"
+# the native broker's counters, see message_broker.stats
+STATS_ADDR = "tcp://127.0.0.1:5557"
+# subscribers report what they consumed to the native broker, which sends each
+# its messages at that rate and the publishers the rates their subscribers can
+# take on RATES_TOPIC, see native/broker/broker.h
+FEEDBACK_ADDR = "tcp://127.0.0.1:5558"
+RATES_TOPIC = b"\0rates"
+# every message carries its Origin, the latency collector (make -C native
+# collector.elf, run while tuning) takes the subscribers' reports of when they
+# consumed one on LATENCY_ADDR and serves its histograms on
+# LATENCY_STATS_ADDR, see message_broker.latency
+LATENCY_ADDR = "tcp://127.0.0.1:5559"
+LATENCY_STATS_ADDR = "tcp://127.0.0.1:5560"
+# messages queued per subscriber and topic, the broker counts what doesn't fit
+HWM = 4
+# used instead of the Python proxy when it is built (make -C native broker.elf)
+NATIVE_BROKER = "../native/broker.elf"
+# topics sent through a shared memory frame ring (native/frame_ring.h) with
+# that many slots: ZMQ only carries a FrameRef and the subscribers get read
+# only views of the ring. needs the frame_ring extension
+SHM_TOPICS = {b"image": 8}
@@ -0,0 +1,50 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# 2026-10-17 23:58
+import sys
+import json
+import zmq
+
+from .config import *
+
+# the histograms of native/collector/collector.h
+HISTOGRAMS = ["capture_publish", "stage", "publish_consume", "capture_consume"]
+
+
+def get_latency(reset=False, timeout_ms=1000):
+    """the latency collector's histograms per topic in us, None if it doesn't
+    answer. reset clears them once they are read"""
+    sock = zmq.Context.instance().socket(zmq.REQ)
+    sock.setsockopt(zmq.LINGER, 0)
+    sock.connect(LATENCY_STATS_ADDR)
+    try:
+        sock.send(b"reset" if reset else b"")
+        if not sock.poll(timeout_ms):
+            return None
+        return json.loads(sock.recv())
+    finally:
+        sock.close()
+
+
+if __name__ == "__main__":
+    # python -m message_broker.latency [--reset]
+    stats = get_latency("--reset" in sys.argv[1:])
+    if stats is None:
+        print("no latency collector at", LATENCY_STATS_ADDR)
+    else:
+        print(f"{stats['uptime_s']:.1f} s, ms")
+        print(
+            f"{'topic':<24}{'':<16}{'count':>8}{'mean':>8}{'p50':>8}"
+            f"{'p90':>8}{'p99':>8}{'max':>8}"
+        )
+        for topic, histograms in stats["topics"].items():
+            for name in HISTOGRAMS:
+                h = histograms[name]
+                if not h["count"]:
+                    continue
+                ms = [h[k] / 1000 for k in ["mean", "p50", "p90", "p99", "max"]]
+                print(
+                    f"{topic:<24}{name:<16}{h['count']:>8}"
+                    + "".join(f"{v:>8.1f}" for v in ms)
+                )
+                topic = ""
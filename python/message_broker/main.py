@@ -1,22 +1,35 @@
 #!/usr/bin/env python3
 # -*- coding: utf-8 -*-
 # 2021-02-20 14:46
+import os
+import subprocess
 
 from .transport import *
 from .config import *
 
 
 def run():
+    broker = os.path.join(
+        os.path.dirname(os.path.dirname(os.path.abspath(__file__))), NATIVE_BROKER
+    )
+    if os.path.exists(broker):
+        # its own process, the forwarding never waits for the GIL
+        subprocess.run(
+            [broker, INBOUND_ADDR, OUTBOUND_ADDR, STATS_ADDR, FEEDBACK_ADDR, str(HWM)],
+            check=True,
+        )
+        return
+
     ctx = zmq.Context()
-    sub_sock = ctx.socket(zmq.SUB)
+    sub_sock = ctx.socket(zmq.XSUB)
     sub_sock.bind(INBOUND_ADDR)
-    sub_sock.subscribe(b"")
 
-    pub_sock = ctx.socket(zmq.PUB)
+    pub_sock = ctx.socket(zmq.XPUB)
+    pub_sock.setsockopt(zmq.SNDHWM, HWM)
     pub_sock.bind(OUTBOUND_ADDR)
 
-    while True:
-        pub_sock.send(sub_sock.recv())
+    # forwards in libzmq without the GIL, no stats and no throttling
+    zmq.proxy(sub_sock, pub_sock)
 
 
 if __name__ == "__main__":
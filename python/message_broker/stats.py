@@ -0,0 +1,52 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# 2026-10-17 23:40
+import json
+import zmq
+
+from .config import *
+
+
+def get_stats(timeout_ms=1000):
+    """the native broker's per topic counters, None if it doesn't answer"""
+    sock = zmq.Context.instance().socket(zmq.REQ)
+    sock.setsockopt(zmq.LINGER, 0)
+    sock.connect(STATS_ADDR)
+    try:
+        sock.send(b"")
+        if not sock.poll(timeout_ms):
+            return None
+        return json.loads(sock.recv())
+    finally:
+        sock.close()
+
+
+if __name__ == "__main__":
+    # python -m message_broker.stats
+    stats = get_stats()
+    if stats is None:
+        print("no native broker at", STATS_ADDR)
+    else:
+        rate = lambda r: "-" if r is None else f"{r:.1f}"
+        print(
+            f"{'topic':<24}{'messages':>10}{'MB':>10}{'dropped':>10}"
+            f"{'rate':>8}{'limit':>8}"
+        )
+        for topic, counters in stats["topics"].items():
+            print(
+                f"{topic:<24}{counters['messages']:>10}"
+                f"{counters['bytes'] / 1e6:>10.1f}{counters['dropped']:>10}"
+                f"{rate(counters['rate']):>8}{rate(counters['limit']):>8}"
+            )
+        # the rate is what a subscriber consumes while it is throttled
+        print()
+        print(
+            f"{'subscriber':<16}{'topic':<24}{'sent':>10}{'throttled':>10}"
+            f"{'dropped':>10}{'rate':>8}"
+        )
+        for sub_id, counters in stats["subscribers"].items():
+            print(
+                f"{sub_id:<16}{counters['topic']:<24}{counters['sent']:>10}"
+                f"{counters['throttled']:>10}{counters['dropped']:>10}"
+                f"{rate(counters['rate']):>8}"
+            )
@@ -13,11 +13,23 @@ class Throttler(object):
         }
 
         self.next_time = {}
+        # what the native broker's subscribers can take, topic: rate, as of
+        # limits_time. lower than the rates above or it isn't there
+        self.limits = {}
+        self.limits_time = 0
+
+    def limit(self, limits):
+        self.limits = limits
+        self.limits_time = time.time()
 
     def is_send_allowed(self, topic):
         current = round(time.time() * 1000)
         next = self.next_time.get(topic, current)
         if current < next:
             return False
-        self.next_time[topic] = current + 1000 // self.throttle.get(topic, FPS)
+        rate = self.throttle.get(topic, FPS)
+        # the broker sends them every second, stale ones are of a gone broker
+        if topic in self.limits and current - self.limits_time * 1000 < 3000:
+            rate = min(rate, self.limits[topic])
+        self.next_time[topic] = current + round(1000 / rate)
         return True
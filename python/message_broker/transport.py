@@ -2,13 +2,74 @@
 # -*- coding: utf-8 -*-
 # 2021-02-23 11:19
 import zmq
+import os
+import json
+import time
 import pickle
+import struct
+import itertools
+import threading
+import numpy as np
+from collections import namedtuple
 from PyQt5.QtCore import QRunnable, QThreadPool
 
+try:
+    import frame_ring  # type: ignore
+except ImportError:
+    frame_ring = None
+
 from .config import *
 from .throttler import Throttler
 
-_MSG_DELIMITER = b":"
+try:
+    from . import codec
+except ImportError:
+    codec = None
+
+# what is sent instead of a frame of a SHM_TOPICS topic
+FrameRef = namedtuple("FrameRef", ["ring", "instance", "slot", "seq"])
+
+# where a message comes from: the frame it was derived from, when that was
+# captured and when the stage publishing it got its input, monotonic ns
+# (time.monotonic_ns, steady_clock natively). sent as the last part of every
+# message, packed with the time it was published
+Origin = namedtuple("Origin", ["frame_id", "capture_ns", "received_ns"])
+ORIGIN_FORMAT = "<4q"
+
+_frame_ids = itertools.count()
+
+
+def process_frame_id(n):
+    # the n-th frame of this process, unique across the processes publishing
+    # frames: the pid in the upper 32 bits
+    return (os.getpid() << 32) | (n & 0xFFFFFFFF)
+
+
+def monotonic_ns_of(system_ns):
+    # time.monotonic_ns of a time.time_ns, e.g. a sensor timestamp, like
+    # CaptureNs() in native/calculators.cc. a time ahead of the clock is now
+    return time.monotonic_ns() - max(time.time_ns() - system_ns, 0)
+
+
+def new_origin(capture_ns=None):
+    # the origin of a new frame captured at capture_ns (monotonic, now if
+    # None), which the capturing stage got as its input
+    if capture_ns is None:
+        capture_ns = time.monotonic_ns()
+    return Origin(process_frame_id(next(_frame_ids)), capture_ns, capture_ns)
+
+
+# the origin of the message whose callback runs on this thread, what the
+# callback publishes is derived from it
+_current = threading.local()
+
+
+def _ring_name(topic):
+    return "inu_" + topic.decode()
+
+
+# the ids of the subscriber sockets of this process
+_subscriber_ids = itertools.count()
 
 
 class Publisher(object):
@@ -17,10 +78,60 @@ class Publisher(object):
         self.ctx = zmq.Context()
         self.sock = self.ctx.socket(zmq.PUB)
         self.sock.connect(INBOUND_ADDR)
+        # the native broker's limits, for the throttler
+        self.rates = self.ctx.socket(zmq.SUB)
+        self.rates.connect(OUTBOUND_ADDR)
+        self.rates.subscribe(RATES_TOPIC)
+        self.rings = {}
 
-    def pub(self, topic, data=None):
+    def pub(self, topic, data=None, origin=None, encoded=False):
+        # encoded: data is a codec Message already (the native stages encode
+        # their own) and sent as it is
+        if self.rates.poll(0):
+            self._read_rates()
         if self.throttler.is_send_allowed(topic):
-            self.sock.send(topic + _MSG_DELIMITER + pickle.dumps(data))
+            if origin is None:
+                origin = getattr(_current, "origin", None)
+            if origin is None:
+                # not derived from a message, a new frame
+                origin = new_origin()
+            if encoded:
+                payload = data
+            else:
+                if frame_ring and topic in SHM_TOPICS and isinstance(data, np.ndarray):
+                    data = self._to_ring(topic, data)
+                # the payloads of native/topics.fbs as FlatBuffers, the rest
+                # pickled
+                payload = codec.encode(data) if codec else None
+                if payload is None:
+                    payload = pickle.dumps(data)
+            origin = struct.pack(ORIGIN_FORMAT, *origin, time.monotonic_ns())
+            self.sock.send_multipart([topic, payload, origin])
+
+    def _to_ring(self, topic, image):
+        ring = self.rings.get(topic)
+        if ring is None or ring.slot_size < image.nbytes:
+            # the old ring unlinks its name, drop it before making the new one
+            self.rings.pop(topic, None)
+            ring = frame_ring.Writer(_ring_name(topic), image.nbytes, SHM_TOPICS[topic])
+            self.rings[topic] = ring
+        ref = ring.write(image)
+        if ref is None:
+            # every slot is pinned by a subscriber, send the frame itself
+            return image
+        return FrameRef(_ring_name(topic), *ref)
+
+    def _read_rates(self):
+        frames = None
+        try:
+            while True:
+                frames = self.rates.recv_multipart(zmq.NOBLOCK)
+        except zmq.Again:
+            pass
+        if frames:
+            rates = json.loads(frames[1])
+            # the broker escapes topics byte by byte
+            self.throttler.limit({t.encode("latin-1"): r for t, r in rates.items()})
 
 
 class Subscriber(object):
@@ -28,15 +139,24 @@ class Subscriber(object):
         self.poller = zmq.Poller()
         self.ctx = zmq.Context()
         self.callback = None
+        self.rings = {}
+        self.feedback = None
+        self.latency = None
 
     def sub(self, topics, callback):
         if isinstance(topics, bytes):
             topics = [topics]
         for topic in topics:
             sock = self.ctx.socket(zmq.SUB)
-            sock.setsockopt(zmq.CONFLATE, 1)
+            # CONFLATE can't take multipart messages: a short queue that
+            # _recv drains to the latest message instead
+            sock.setsockopt(zmq.RCVHWM, HWM)
             sock.connect(OUTBOUND_ADDR)
             sock.subscribe(topic)
+            # the native broker only serves sockets that name themselves, and
+            # sends them their topics as topic \0 id \0 (native/broker/broker.h)
+            sub_id = b"%d.%d" % (os.getpid(), next(_subscriber_ids))
+            sock.subscribe(b"\0" + sub_id + b"\0" + topic)
             self.poller.register(sock, zmq.POLLIN)
             self.callback = callback
         return self
@@ -44,13 +164,85 @@ class Subscriber(object):
     def _recv(self):
         ready_socks = dict(self.poller.poll())
         for sock in ready_socks.keys():
-            raw_data = sock.recv()
-            index = raw_data.index(_MSG_DELIMITER)
-            topic, data = (
-                raw_data[:index],
-                pickle.loads(raw_data[index + 1 :]),
-            )
-            self.callback(topic, data)
+            frames = sock.recv_multipart(copy=False)
+            count = 1
+            try:
+                while True:
+                    frames = sock.recv_multipart(zmq.NOBLOCK, copy=False)
+                    count += 1
+            except zmq.Again:
+                pass
+            received_ns = time.monotonic_ns()
+            topic, payload = frames[0].bytes, frames[1].buffer
+            # the packed Origin and publish time
+            origin = frames[2].bytes if len(frames) > 2 else None
+            sub_id = None
+            if b"\0" in topic:
+                prefix, sub_id, rest = topic.split(b"\0", 2)
+                topic = prefix + rest
+            if codec and codec.is_message(payload):
+                # arrays in it are views of the message
+                data = codec.decode(payload)
+            else:
+                data = pickle.loads(payload)
+            missed = False
+            if isinstance(data, FrameRef):
+                data = self._from_ring(data)
+                # overwritten before we got to it
+                missed = data is None
+            if origin is not None:
+                frame_id, capture_ns, _, _ = struct.unpack(ORIGIN_FORMAT, origin)
+                _current.origin = Origin(frame_id, capture_ns, received_ns)
+            try:
+                if not missed:
+                    self.callback(topic, data)
+            finally:
+                _current.origin = None
+            if sub_id is not None:
+                self._report(sub_id, count)
+            if origin is not None and not missed:
+                self._report_latency(topic, origin)
+
+    def _report(self, sub_id, count):
+        # count messages came off the queue, the broker measures how fast we
+        # consume by these
+        if self.feedback is None:
+            self.feedback = self.ctx.socket(zmq.PUSH)
+            self.feedback.setsockopt(zmq.LINGER, 0)
+            self.feedback.connect(FEEDBACK_ADDR)
+        try:
+            self.feedback.send_multipart([sub_id, b"%d" % count], zmq.NOBLOCK)
+        except zmq.Again:
+            pass
+
+    def _report_latency(self, topic, origin):
+        # the message is consumed once the callback returned
+        if self.latency is None:
+            # nothing queues up while no collector runs
+            self.latency = self.ctx.socket(zmq.PUSH)
+            self.latency.setsockopt(zmq.IMMEDIATE, 1)
+            self.latency.setsockopt(zmq.LINGER, 0)
+            self.latency.connect(LATENCY_ADDR)
+        consumed = struct.pack("<q", time.monotonic_ns())
+        try:
+            self.latency.send_multipart([topic, origin, consumed], zmq.NOBLOCK)
+        except zmq.Again:
+            pass
+
+    def _from_ring(self, ref):
+        ring = self.rings.get(ref.ring)
+        if ring is None or ring.instance != ref.instance:
+            # the publisher made a new ring, views of the old one stay valid
+            try:
+                ring = frame_ring.Reader(ref.ring)
+            except OSError:
+                return None
+            self.rings[ref.ring] = ring
+        if ring.instance != ref.instance:
+            return None
+        frame = ring.read(ref.slot, ref.seq)
+        # pins the slot until the array is gone
+        return None if frame is None else np.asarray(frame)
 
     def loop(self):
         while True:
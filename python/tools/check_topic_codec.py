@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# 2026-10-17 23:59
+# the round trip of the topic payloads between message_broker/codec.py and
+# native/topic_codec.h: every sample is encoded here, read and written again
+# by native/tools/topic_codec_check.cc and decoded here, and has to come back
+# as it was. run by `make check_topic_codec` in native/
+import argparse
+import struct
+import subprocess
+import sys
+
+import numpy as np
+
+from box_detection.box_detector import Box
+from common.util import ROIImage
+from message_broker import codec
+from message_broker.transport import FrameRef
+
+parser = argparse.ArgumentParser()
+parser.add_argument("check_elf", type=str, help="topic_codec_check.elf")
+FLAGS = parser.parse_args()
+
+
+def samples():
+    rng = np.random.default_rng(0)
+    # the native FaceBox has the 6 keypoints of face detection
+    yield Box(0.875, [10, 20, 30, 40, *range(12)], 6)
+    image = rng.integers(0, 256, (24, 32, 3), dtype=np.uint8)
+    yield ROIImage(image, np.arange(9, dtype=np.float64).reshape(3, 3) / 7)
+    yield ROIImage(image[..., 0].copy(), np.eye(3))
+    yield rng.standard_normal((468, 3)).astype(np.float32)
+    yield rng.standard_normal((2, 21, 3))
+    yield np.arange(-5, 5, dtype=np.int64).reshape(5, 2)
+    yield np.arange(6, dtype=np.int16).reshape(2, 3)
+    yield "victory"
+    yield codec.Embedding(rng.standard_normal(128).astype(np.float32), "alice")
+    yield codec.Embedding(np.zeros(0, np.float32), "")
+    yield FrameRef("inu_image", 2**40 + 3, 7, 2**33 + 1)
+
+
+def expected(data):
+    # what a round trip has to give back
+    if isinstance(data, np.ndarray):
+        dtype = np.float32 if data.dtype.kind == "f" else np.int32
+        return data.astype(dtype)
+    return data
+
+
+def same(a, b):
+    if isinstance(a, Box):
+        return vars(a) == vars(b)
+    if isinstance(a, np.ndarray):
+        return a.dtype == b.dtype and a.shape == b.shape and np.array_equal(a, b)
+    if isinstance(a, tuple):
+        return type(a) is type(b) and all(same(x, y) for x, y in zip(a, b))
+    return a == b
+
+
+def round_trip(messages):
+    stdin = b"".join(struct.pack("=I", len(m)) + m for m in messages)
+    stdout = subprocess.run(
+        [FLAGS.check_elf], input=stdin, stdout=subprocess.PIPE, check=True
+    ).stdout
+    results = []
+    pos = 0
+    while pos < len(stdout):
+        (size,) = struct.unpack_from("=I", stdout, pos)
+        results.append(stdout[pos + 4 : pos + 4 + size])
+        pos += 4 + size
+    return results
+
+
+def main():
+    data = list(samples())
+    messages = [bytes(codec.encode(d)) for d in data]
+    results = round_trip(messages)
+    if len(results) != len(messages):
+        print(f"{len(results)} of {len(messages)} messages came back")
+        return 1
+    failed = 0
+    for sample, message in zip(data, results):
+        name = type(sample).__name__
+        if not message:
+            print(f"FAIL {name}: didn't parse natively")
+            failed += 1
+        elif not same(expected(sample), codec.decode(message)):
+            print(f"FAIL {name}: {codec.decode(message)!r} != {sample!r}")
+            failed += 1
+    print(f"{len(data) - failed} of {len(data)} payloads round tripped")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
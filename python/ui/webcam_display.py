@@ -231,7 +231,8 @@ class WebcamDisplay(object):
             self.fps.update("face_landmark")
 
         if topic == b"image":
-            self.image = data
+            # annotated in place, frames from the shared memory ring are read only
+            self.image = data if data.flags.writeable else data.copy()
             self.fps.update("webcam")
 
         if topic == b"eye_landmark":
@@ -2,3 +2,6 @@
 # -*- coding: utf-8 -*-
 # 2021-03-10 13:31
 DEVICE = "webcam"               # webcam or inu
+# PIPELINE = "native" only, see OpenFrameSource in native/frame_source.h
+NATIVE_SOURCE = "inu:async"
+NATIVE_FACE_MODEL = "../model/face_detection_front.tflite"
@@ -2,11 +2,17 @@
 # -*- coding: utf-8 -*-
 # 2021-03-02 10:35
 from .video_capture import WebCamVideoCapture, InuVideoCapture
-from message_broker import Publisher
+from message_broker import Publisher, new_origin
 from .config import *
+from config import *
 
 
 def run():
+    if PIPELINE == "native":
+        from .native_pipeline import NativeFacePipeline
+
+        NativeFacePipeline().run()
+        return
     if DEVICE == "webcam":
         vc = WebCamVideoCapture()
     else:
@@ -14,9 +20,9 @@ def run():
     publisher = Publisher()
     while True:
         # ZMQ_PUB: image
-        image = vc.capture()
+        image, capture_ns = vc.capture()
         if image is not None:
-            publisher.pub(b"image", image)
+            publisher.pub(b"image", image, new_origin(capture_ns))
 
 
 if __name__ == "__main__":
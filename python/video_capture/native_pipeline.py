@@ -0,0 +1,43 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+# 2026-10-17 22:10
+import numpy as np
+
+from .config import *
+from message_broker import Publisher, Origin, process_frame_id
+from common import util
+
+# native/pyext/inu_graph.cc, built by `make inu_graph.so`
+import inu_graph  # type: ignore
+
+
+class NativeFacePipeline(object):
+    """capture -> face detection -> face_roi in native/calculators.h.
+
+    publishes image, face_reset, face_box, face_roi and face_roi_small as the
+    video_capture and face_detection apps do
+    """
+
+    def __init__(self):
+        self.publisher = Publisher()
+        self.pipeline = inu_graph.FacePipeline(
+            NATIVE_SOURCE, util.get_resource(NATIVE_FACE_MODEL), self
+        )
+
+    def __call__(self, topic, data, frame_id, capture_ns):
+        # the native stages got the frame when it was captured
+        origin = Origin(process_frame_id(frame_id), capture_ns, capture_ns)
+        if isinstance(data, bytes):
+            # face_box and face_roi come encoded (native/topic_codec.h)
+            self.publisher.pub(topic, data, origin, encoded=True)
+            return
+        # the buffers are read only views of the native frames
+        if topic == b"image" or topic == b"face_roi_small":
+            data = np.asarray(data)
+        self.publisher.pub(topic, data, origin)
+
+    def run(self):
+        # blocks until the source ends, without holding the GIL
+        self.pipeline.run()
+        for name, runs, mean_us, max_us in self.pipeline.stats():
+            print(f"{name}: {runs} runs, {mean_us:.0f} us mean, {max_us:.0f} us max")
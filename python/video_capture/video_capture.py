@@ -7,9 +7,10 @@ import time
 
 from .config import *
 from config import *
+from message_broker import monotonic_ns_of
 
 if DEVICE == "inu":
-    import inu_stream  # type: ignore
+    import inu_frames  # type: ignore
 
 
 class WebCamVideoCapture(object):
@@ -17,21 +18,22 @@ class WebCamVideoCapture(object):
         self.vid = cv2.VideoCapture(0)
 
     def capture(self):
-        return cv2.cvtColor(cv2.flip(self.vid.read()[1], 2), cv2.COLOR_BGR2RGB)
+        # the frame and when it was captured, monotonic ns
+        image = self.vid.read()[1]
+        capture_ns = time.monotonic_ns()
+        return cv2.cvtColor(cv2.flip(image, 2), cv2.COLOR_BGR2RGB), capture_ns
 
 
 class InuVideoCapture(object):
     def __init__(self):
-        self.height, self.width = inu_stream.shape()
+        # RGB and mirrored natively, read() blocks without holding the GIL
+        self.stream = inu_frames.Capture(async_=True, flip=True, rgb=True)
+        self.height, self.width = self.stream.shape()
 
     def capture(self):
-        image = inu_stream.read_bgr_image(self.height * self.width * 3)  # type: ignore
-        if image is None:
-            return None
-        return cv2.cvtColor(
-            np.reshape(
-                image,
-                (self.height, self.width, 3),
-            ),
-            cv2.COLOR_BGR2RGB,
-        )
+        # the frame and when the sensor captured it, monotonic ns
+        frame = self.stream.read()
+        if frame is None:
+            return None, None
+        # a read only view of the native frame, no copy
+        return np.asarray(frame[0]), monotonic_ns_of(frame[2])